@@ -0,0 +1,251 @@
+/* -*- mode: c++ -*- */
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace json {
+    /// Bump allocator backing a parsed document.  Memory is handed out from
+    /// a chain of blocks that grow geometrically and is only returned all at
+    /// once, when the arena is released or destroyed, so freeing a document
+    /// costs one deallocation per block rather than one per node.
+    /// Destructors of objects created in the arena are never run.
+    ///
+    /// The arena is also a std::pmr::memory_resource so that standard
+    /// containers can live inside it.
+    class Arena : public std::pmr::memory_resource {
+        struct Block {
+            Block *next;
+            std::size_t size;
+        };
+
+        static constexpr std::size_t FIRST_BLOCK_SIZE = 4096;
+        static constexpr std::size_t MAX_BLOCK_SIZE = 1 << 20;
+
+        Block *head_ = nullptr;
+        // Blocks kept by reset() for reuse, newest first.
+        Block *spare_ = nullptr;
+        char *cur_ = nullptr;
+        char *end_ = nullptr;
+        std::size_t next_block_size_ = FIRST_BLOCK_SIZE;
+        std::size_t block_count_ = 0;
+        std::size_t bytes_reserved_ = 0;
+
+        /// Unlinks and returns the newest spare block of at least `size'
+        /// bytes, or null.
+        Block *take_spare(std::size_t size) {
+            for (Block **link = &spare_; *link != nullptr;
+                 link = &(*link)->next) {
+                Block *block = *link;
+                if (block->size >= size) {
+                    *link = block->next;
+                    return block;
+                }
+            }
+            return nullptr;
+        }
+
+        static void free_chain(Block *block) {
+            while (block != nullptr) {
+                Block *next = block->next;
+                ::operator delete(block);
+                block = next;
+            }
+        }
+
+        void *allocate_slow(std::size_t size, std::size_t align) {
+            std::size_t needed = sizeof(Block) + size + align;
+            Block *block = take_spare(needed);
+            if (block == nullptr) {
+                std::size_t block_size = next_block_size_;
+                if (needed > block_size) {
+                    // Oversized requests get a block of their own and
+                    // leave the growth schedule alone.
+                    block_size = needed;
+                } else if (next_block_size_ < MAX_BLOCK_SIZE) {
+                    next_block_size_ *= 2;
+                }
+
+                block = static_cast<Block *>(::operator new(block_size));
+                block->size = block_size;
+                ++block_count_;
+                bytes_reserved_ += block_size;
+            }
+            block->next = head_;
+            head_ = block;
+
+            cur_ = reinterpret_cast<char *>(block + 1);
+            end_ = reinterpret_cast<char *>(block) + block->size;
+            return allocate_raw(size, align);
+        }
+
+    protected:
+        void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+            return allocate_raw(bytes, alignment);
+        }
+
+        void do_deallocate(void *, std::size_t, std::size_t) override {}
+
+        bool do_is_equal(
+            const std::pmr::memory_resource &other) const noexcept override {
+            return this == &other;
+        }
+
+    public:
+        Arena() = default;
+
+        Arena(const Arena &) = delete;
+        Arena &operator=(const Arena &) = delete;
+
+        Arena(Arena &&another) noexcept { *this = std::move(another); }
+
+        Arena &operator=(Arena &&another) noexcept {
+            if (this != &another) {
+                release();
+                head_ = std::exchange(another.head_, nullptr);
+                spare_ = std::exchange(another.spare_, nullptr);
+                cur_ = std::exchange(another.cur_, nullptr);
+                end_ = std::exchange(another.end_, nullptr);
+                next_block_size_ =
+                    std::exchange(another.next_block_size_, FIRST_BLOCK_SIZE);
+                block_count_ = std::exchange(another.block_count_, 0);
+                bytes_reserved_ = std::exchange(another.bytes_reserved_, 0);
+            }
+            return *this;
+        }
+
+        ~Arena() override { release(); }
+
+        /// Returns `size' bytes aligned to `align', which must be a power
+        /// of two.
+        void *allocate_raw(std::size_t size, std::size_t align) {
+            std::size_t pad = -reinterpret_cast<std::uintptr_t>(cur_) &
+                              (align - 1);
+            if (cur_ == nullptr ||
+                static_cast<std::size_t>(end_ - cur_) < size + pad) {
+                return allocate_slow(size, align);
+            }
+            char *result = cur_ + pad;
+            cur_ = result + size;
+            return result;
+        }
+
+        template <typename T, typename... Args> T *make(Args &&...args) {
+            return new (allocate_raw(sizeof(T), alignof(T)))
+                T(std::forward<Args>(args)...);
+        }
+
+        /// Copies `count' trivially copyable objects into the arena.
+        template <typename T> T *copy(const T *data, std::size_t count) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            if (count == 0) {
+                return nullptr;
+            }
+            T *result =
+                static_cast<T *>(allocate_raw(sizeof(T) * count, alignof(T)));
+            std::memcpy(result, data, sizeof(T) * count);
+            return result;
+        }
+
+        std::string_view copy(std::string_view str) {
+            return {copy(str.data(), str.size()), str.size()};
+        }
+
+        /// Frees every block.  All pointers into the arena become dangling.
+        void release() {
+            free_chain(std::exchange(head_, nullptr));
+            free_chain(std::exchange(spare_, nullptr));
+            cur_ = end_ = nullptr;
+            next_block_size_ = FIRST_BLOCK_SIZE;
+            block_count_ = 0;
+            bytes_reserved_ = 0;
+        }
+
+        /// Empties the arena and hands its newest block, which is the
+        /// largest unless an oversized request made it, out again from the
+        /// start.  Older blocks, newest first, are kept as spares for
+        /// later allocations as long as the arena then holds at most
+        /// `keep_bytes'; the rest are freed.  New blocks continue to grow
+        /// from where they left off.  So when the arena is reset between
+        /// documents of similar size, the kept block soon holds a whole
+        /// document up to MAX_BLOCK_SIZE, and larger documents are built
+        /// in the spares if `keep_bytes' leaves room for them.  All
+        /// pointers into the arena become dangling.
+        void reset(std::size_t keep_bytes = 0) {
+            if (head_ == nullptr) {
+                return;
+            }
+            Block *keep = head_;
+            Block *older = keep->next;
+            Block *spares = spare_;
+            keep->next = nullptr;
+            spare_ = nullptr;
+            block_count_ = 1;
+            bytes_reserved_ = keep->size;
+
+            Block **tail = &spare_;
+            for (Block *chain : {older, spares}) {
+                while (chain != nullptr) {
+                    Block *block = chain;
+                    chain = chain->next;
+                    if (bytes_reserved_ + block->size <= keep_bytes) {
+                        *tail = block;
+                        tail = &block->next;
+                        ++block_count_;
+                        bytes_reserved_ += block->size;
+                    } else {
+                        ::operator delete(block);
+                    }
+                }
+            }
+            *tail = nullptr;
+
+            head_ = keep;
+            cur_ = reinterpret_cast<char *>(keep + 1);
+            end_ = reinterpret_cast<char *>(keep) + keep->size;
+        }
+
+        /// Takes over the blocks of `other', which is left empty, so that
+        /// they are freed with this arena.  Allocation continues in this
+        /// arena's current block.
+        void adopt(Arena &&other) {
+            if (other.head_ == nullptr) {
+                return;
+            } else if (head_ == nullptr) {
+                *this = std::move(other);
+                return;
+            }
+            // Spares would only be held, not used.
+            while (Block *spare = other.spare_) {
+                other.spare_ = spare->next;
+                --other.block_count_;
+                other.bytes_reserved_ -= spare->size;
+                ::operator delete(spare);
+            }
+            Block *tail = other.head_;
+            while (tail->next != nullptr) {
+                tail = tail->next;
+            }
+            tail->next = head_->next;
+            head_->next = std::exchange(other.head_, nullptr);
+            block_count_ += other.block_count_;
+            bytes_reserved_ += other.bytes_reserved_;
+            other.release();
+        }
+
+        /// Blocks held, spares included.
+        std::size_t block_count() const { return block_count_; }
+
+        /// Bytes obtained from the global allocator, including unused tails.
+        std::size_t bytes_reserved() const { return bytes_reserved_; }
+    };
+} // namespace json
+
+#endif
@@ -0,0 +1,41 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <benchmark/benchmark.h>
+
+#include "bench.h"
+
+namespace {
+    // Atomic because the threaded benchmarks allocate concurrently.
+    // Relaxed suffices: only the totals are read, between iterations.
+    std::atomic<std::size_t> allocations = 0;
+    std::atomic<std::size_t> allocated_bytes = 0;
+} // namespace
+
+// Counting replacements for the global allocation functions.  The other
+// overloads (nothrow, array, sized delete) forward to these by default.
+void *operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void *p = std::malloc(size != 0 ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+namespace bench {
+    std::size_t allocation_count() {
+        return allocations.load(std::memory_order_relaxed);
+    }
+
+    std::size_t allocation_bytes() {
+        return allocated_bytes.load(std::memory_order_relaxed);
+    }
+} // namespace bench
+
+BENCHMARK_MAIN();
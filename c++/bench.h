@@ -0,0 +1,23 @@
+/* -*- mode: c++ -*- */
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <cstddef>
+#include <string>
+
+namespace bench {
+    /// Number of calls to global operator new since the program started.
+    std::size_t allocation_count();
+
+    /// Total bytes requested from global operator new.
+    std::size_t allocation_bytes();
+
+    /// The documents of the benchmark corpus, each about a megabyte.
+    enum class Corpus { TWITTER, NUMBERS, NESTED, LONG_STRINGS, ESCAPES };
+
+    /// Generates `kind' on first use.  The generator is seeded and
+    /// platform-independent, so every run parses the same bytes.
+    const std::string &corpus(Corpus kind);
+} // namespace bench
+
+#endif
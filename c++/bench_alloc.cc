@@ -0,0 +1,145 @@
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "bench.h"
+#include "parse.h"
+
+namespace {
+    std::string make_records(int records) {
+        std::string doc = "[";
+        for (int i = 0; i < records; ++i) {
+            if (i != 0) {
+                doc += ',';
+            }
+            std::string n = std::to_string(i);
+            doc += R"({"id":)" + n + R"(,"name":"user)" + n +
+                   R"(","active":true,"score":)" + n + R"(.5,"tags":["a","b"],)"
+                   R"("geo":{"lat":35.6,"lon":139.7},"parent":null})";
+        }
+        doc += ']';
+        return doc;
+    }
+
+    const std::string &records_doc() {
+        static const std::string doc = make_records(10000);
+        return doc;
+    }
+
+    /// Parse followed by destruction of the document, which is the whole
+    /// allocation lifecycle of a tree.  With borrowed:1 strings refer into
+    /// the input instead of being copied.
+    void BM_alloc_parse_and_free(benchmark::State &state) {
+        const std::string &doc = records_doc();
+        bool borrowed = state.range(0) != 0;
+        std::size_t allocs = 0;
+        std::size_t bytes = 0;
+        for (auto _ : state) {
+            std::size_t allocs_before = bench::allocation_count();
+            std::size_t bytes_before = bench::allocation_bytes();
+            {
+                json::JSON_File file =
+                    borrowed ? json::parse_borrowed(doc)
+                             : json::parse(std::string_view(doc));
+                benchmark::DoNotOptimize(file.ok());
+            }
+            allocs += bench::allocation_count() - allocs_before;
+            bytes += bench::allocation_bytes() - bytes_before;
+        }
+        state.counters["allocs/doc"] = benchmark::Counter(
+            static_cast<double>(allocs), benchmark::Counter::kAvgIterations);
+        state.counters["alloc_bytes/doc"] = benchmark::Counter(
+            static_cast<double>(bytes), benchmark::Counter::kAvgIterations);
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                                doc.size());
+    }
+    BENCHMARK(BM_alloc_parse_and_free)
+        ->ArgName("borrowed")
+        ->Arg(0)
+        ->Arg(1)
+        ->Unit(benchmark::kMillisecond);
+
+    /// Destruction alone.
+    void BM_alloc_free(benchmark::State &state) {
+        const std::string &doc = records_doc();
+        for (auto _ : state) {
+            state.PauseTiming();
+            auto *file = new json::JSON_File(json::parse(std::string_view(doc)));
+            state.ResumeTiming();
+            delete file;
+        }
+    }
+    BENCHMARK(BM_alloc_free)->Unit(benchmark::kMicrosecond)->Iterations(50);
+
+    /// A request loop over small documents, with a new tree per document
+    /// (reuse:0) or one Parser that keeps its memory (reuse:1).
+    void BM_alloc_small_docs(benchmark::State &state) {
+        std::vector<std::string> docs;
+        for (int i = 0; i < 64; ++i) {
+            docs.push_back(make_records(1 + i % 8));
+        }
+        bool reuse = state.range(0) != 0;
+        json::Parser parser;
+        std::size_t allocs = 0;
+        std::size_t bytes = 0;
+        std::size_t processed = 0;
+        std::size_t i = 0;
+        for (auto _ : state) {
+            const std::string &doc = docs[i++ % docs.size()];
+            std::size_t allocs_before = bench::allocation_count();
+            std::size_t bytes_before = bench::allocation_bytes();
+            if (reuse) {
+                benchmark::DoNotOptimize(parser.parse(doc).ok());
+            } else {
+                json::JSON_File file = json::parse(std::string_view(doc));
+                benchmark::DoNotOptimize(file.ok());
+            }
+            allocs += bench::allocation_count() - allocs_before;
+            bytes += bench::allocation_bytes() - bytes_before;
+            processed += doc.size();
+        }
+        state.counters["allocs/doc"] = benchmark::Counter(
+            static_cast<double>(allocs), benchmark::Counter::kAvgIterations);
+        state.counters["alloc_bytes/doc"] = benchmark::Counter(
+            static_cast<double>(bytes), benchmark::Counter::kAvgIterations);
+        state.SetBytesProcessed(static_cast<std::int64_t>(processed));
+    }
+    BENCHMARK(BM_alloc_small_docs)->ArgName("reuse")->Arg(0)->Arg(1);
+
+    /// The records document, whose tree takes about 8 MB of arena, parsed
+    /// over and over by a new tree per parse (reuse:0) or by one Parser
+    /// whose high-water mark lets it keep all of that memory (reuse:1).
+    void BM_alloc_large_docs(benchmark::State &state) {
+        const std::string &doc = records_doc();
+        bool reuse = state.range(0) != 0;
+        json::Parser parser(64, 64 << 20);
+        // Grows the parser's memory outside the measurement.
+        parser.parse(doc);
+        std::size_t allocs = 0;
+        std::size_t bytes = 0;
+        for (auto _ : state) {
+            std::size_t allocs_before = bench::allocation_count();
+            std::size_t bytes_before = bench::allocation_bytes();
+            if (reuse) {
+                benchmark::DoNotOptimize(parser.parse(doc).ok());
+            } else {
+                json::JSON_File file = json::parse(std::string_view(doc));
+                benchmark::DoNotOptimize(file.ok());
+            }
+            allocs += bench::allocation_count() - allocs_before;
+            bytes += bench::allocation_bytes() - bytes_before;
+        }
+        state.counters["allocs/doc"] = benchmark::Counter(
+            static_cast<double>(allocs), benchmark::Counter::kAvgIterations);
+        state.counters["alloc_bytes/doc"] = benchmark::Counter(
+            static_cast<double>(bytes), benchmark::Counter::kAvgIterations);
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                                doc.size());
+    }
+    BENCHMARK(BM_alloc_large_docs)
+        ->ArgName("reuse")
+        ->Arg(0)
+        ->Arg(1)
+        ->Unit(benchmark::kMillisecond);
+} // namespace
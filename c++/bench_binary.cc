@@ -0,0 +1,89 @@
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "binary.h"
+
+// Every benchmark counts the bytes of the JSON text, so that the rates of
+// loading the text and the binary form compare directly.
+namespace {
+    std::string make_records(int records) {
+        std::string doc = "[";
+        for (int i = 0; i < records; ++i) {
+            if (i != 0) {
+                doc += ',';
+            }
+            std::string n = std::to_string(i);
+            doc += R"({"id":)" + n + R"(,"name":"user)" + n +
+                   R"(","active":true,"score":)" + n + R"(.5,"tags":["a","b"],)"
+                   R"("geo":{"lat":35.6,"lon":139.7},"parent":null})";
+        }
+        doc += ']';
+        return doc;
+    }
+
+    void BM_binary_parse_text(benchmark::State &state) {
+        std::string doc = make_records(10000);
+        for (auto _ : state) {
+            json::JSON_File file = json::parse(std::string_view(doc));
+            benchmark::DoNotOptimize(file.ok());
+        }
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                                doc.size());
+    }
+    BENCHMARK(BM_binary_parse_text);
+
+    void BM_binary_decode(benchmark::State &state) {
+        std::string doc = make_records(10000);
+        std::string binary =
+            json::to_binary(*json::parse(std::string_view(doc)).get_root());
+        for (auto _ : state) {
+            json::JSON_File file = json::parse_binary(binary);
+            benchmark::DoNotOptimize(file.ok());
+        }
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                                doc.size());
+    }
+    BENCHMARK(BM_binary_decode);
+
+    void BM_binary_decode_borrowed(benchmark::State &state) {
+        std::string doc = make_records(10000);
+        std::string binary =
+            json::to_binary(*json::parse(std::string_view(doc)).get_root());
+        for (auto _ : state) {
+            json::JSON_File file = json::parse_binary_borrowed(binary);
+            benchmark::DoNotOptimize(file.ok());
+        }
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                                doc.size());
+    }
+    BENCHMARK(BM_binary_decode_borrowed);
+
+    /// Decoding into the memory of the previous document, which saves
+    /// faulting in fresh pages for every tree.
+    void BM_binary_decode_reuse(benchmark::State &state) {
+        std::string doc = make_records(10000);
+        std::string binary =
+            json::to_binary(*json::parse(std::string_view(doc)).get_root());
+        json::Parser parser(64, 1 << 30);
+        for (auto _ : state) {
+            const json::JSON_File &file = parser.parse_binary(binary);
+            benchmark::DoNotOptimize(file.ok());
+        }
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                                doc.size());
+    }
+    BENCHMARK(BM_binary_decode_reuse);
+
+    void BM_binary_encode(benchmark::State &state) {
+        std::string doc = make_records(10000);
+        json::JSON_File file = json::parse(std::string_view(doc));
+        for (auto _ : state) {
+            std::string binary = json::to_binary(*file.get_root());
+            benchmark::DoNotOptimize(binary.data());
+        }
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                                doc.size());
+    }
+    BENCHMARK(BM_binary_encode);
+} // namespace
@@ -0,0 +1,136 @@
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "bind.h"
+#include "parse.h"
+
+namespace {
+    struct Geo {
+        double lat = 0;
+        double lon = 0;
+    };
+
+    struct User {
+        std::int64_t id = 0;
+        std::string name;
+        bool active = false;
+        double score = 0;
+        std::vector<std::string> tags;
+        Geo geo;
+        std::optional<std::int64_t> parent;
+    };
+} // namespace
+
+template <> struct json::Record<Geo> {
+    static constexpr auto fields = std::make_tuple(
+        json::field("lat", &Geo::lat), json::field("lon", &Geo::lon));
+};
+
+template <> struct json::Record<User> {
+    static constexpr auto fields = std::make_tuple(
+        json::field("id", &User::id), json::field("name", &User::name),
+        json::field("active", &User::active),
+        json::field("score", &User::score), json::field("tags", &User::tags),
+        json::field("geo", &User::geo), json::field("parent", &User::parent));
+};
+
+namespace {
+    std::string make_users(int users) {
+        std::string doc = "[";
+        for (int i = 0; i < users; ++i) {
+            if (i != 0) {
+                doc += ',';
+            }
+            std::string n = std::to_string(i);
+            doc += R"({"id":)" + n + R"(,"name":"user)" + n +
+                   R"(","active":true,"score":)" + n + R"(.5,"tags":["a","b"],)"
+                   R"("geo":{"lat":35.6,"lon":139.7},"parent":null})";
+        }
+        doc += ']';
+        return doc;
+    }
+
+    double number(const json::JSON_Primitive *value) {
+        return static_cast<const json::JSON_Number *>(value)->get_value();
+    }
+
+    std::string_view string(const json::JSON_Primitive *value) {
+        return static_cast<const json::JSON_String *>(value)->get_value();
+    }
+
+    /// Copies a user out of a parsed tree, the way code without bind.h
+    /// has to.
+    User user_from_tree(const json::JSON_Object &object) {
+        User user;
+        user.id = static_cast<std::int64_t>(number(object.get("id")));
+        user.name = string(object.get("name"));
+        user.active = static_cast<const json::JSON_Boolean *>(
+                          object.get("active"))
+                          ->get_value();
+        user.score = number(object.get("score"));
+        const auto *tags =
+            static_cast<const json::JSON_Array *>(object.get("tags"));
+        for (const json::JSON_Primitive *tag : *tags) {
+            user.tags.emplace_back(string(tag));
+        }
+        const auto *geo =
+            static_cast<const json::JSON_Object *>(object.get("geo"));
+        user.geo.lat = number(geo->get("lat"));
+        user.geo.lon = number(geo->get("lon"));
+        const json::JSON_Primitive *parent = object.get("parent");
+        if (parent->get_type() == json::JSON_Type::NUMBER) {
+            user.parent = static_cast<std::int64_t>(number(parent));
+        }
+        return user;
+    }
+
+    void BM_bind_parse(benchmark::State &state) {
+        std::string doc = make_users(10000);
+        for (auto _ : state) {
+            std::vector<User> users;
+            bool ok = json::parse_into(doc, users);
+            benchmark::DoNotOptimize(ok);
+            benchmark::DoNotOptimize(users.data());
+        }
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                                doc.size());
+    }
+    BENCHMARK(BM_bind_parse);
+
+    /// The same structs filled from a tree, for comparison.
+    void BM_bind_tree(benchmark::State &state) {
+        std::string doc = make_users(10000);
+        for (auto _ : state) {
+            json::JSON_File file = json::parse(std::string_view(doc));
+            std::vector<User> users;
+            const auto *root =
+                static_cast<const json::JSON_Array *>(file.get_root());
+            users.reserve(root->size());
+            for (const json::JSON_Primitive *element : *root) {
+                users.push_back(user_from_tree(
+                    *static_cast<const json::JSON_Object *>(element)));
+            }
+            benchmark::DoNotOptimize(users.data());
+        }
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                                doc.size());
+    }
+    BENCHMARK(BM_bind_tree);
+
+    void BM_bind_serialize(benchmark::State &state) {
+        std::vector<User> users;
+        json::parse_into(make_users(10000), users);
+        std::size_t written = 0;
+        for (auto _ : state) {
+            std::string text = json::serialize(users);
+            written += text.size();
+            benchmark::DoNotOptimize(text.data());
+        }
+        state.SetBytesProcessed(static_cast<std::int64_t>(written));
+    }
+    BENCHMARK(BM_bind_serialize);
+} // namespace
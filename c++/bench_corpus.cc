@@ -0,0 +1,275 @@
+#include <cstdint>
+#include <random>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "bench.h"
+#include "parse.h"
+
+namespace {
+    /// Draws from a fixed-seed mt19937, whose output the standard pins
+    /// down, without the distributions, whose output it does not, so that
+    /// every platform generates the same bytes.
+    class Source {
+        std::mt19937 engine_;
+
+    public:
+        explicit Source(std::uint32_t seed) : engine_(seed) {}
+
+        std::uint32_t below(std::uint32_t n) { return engine_() % n; }
+
+        std::string digits(int count) {
+            std::string result;
+            result += static_cast<char>('1' + below(9));
+            for (int i = 1; i < count; ++i) {
+                result += static_cast<char>('0' + below(10));
+            }
+            return result;
+        }
+
+        std::string word() {
+            static const char *const WORDS[] = {
+                "lorem",  "ipsum", "dolor", "sit",    "amet",
+                "json",   "parse", "fast",  "東京",   "café",
+                "naïve",  "日本語", "data",  "stream", "vector",
+            };
+            return WORDS[below(sizeof(WORDS) / sizeof(WORDS[0]))];
+        }
+
+        std::string sentence(int words) {
+            std::string result;
+            for (int i = 0; i < words; ++i) {
+                if (i != 0) {
+                    result += ' ';
+                }
+                result += word();
+            }
+            return result;
+        }
+    };
+
+    /// Status objects shaped like the Twitter search API's: a nested user,
+    /// entity arrays, 64-bit ids both as numbers and strings, HTML and
+    /// non-ASCII text, and plenty of nulls and booleans.
+    std::string make_twitter() {
+        Source src(1);
+        std::string doc = R"({"statuses":[)";
+        for (int i = 0; i < 2000; ++i) {
+            if (i != 0) {
+                doc += ',';
+            }
+            std::string id = src.digits(18);
+            std::string user_id = src.digits(src.below(8) + 3);
+            std::string name = src.word() + std::to_string(src.below(1000));
+            doc += R"({"created_at":"Sun Aug 31 00:29:15 +0000 2014",)";
+            doc += R"("id":)" + id + R"(,"id_str":")" + id + R"(",)";
+            doc += R"("text":")" + src.sentence(src.below(20) + 3) + R"(",)";
+            doc += R"("source":"<a href=\"http://twitter.com/download/)"
+                   R"(iphone\" rel=\"nofollow\">Twitter for iPhone</a>",)"
+                   R"("truncated":false,"in_reply_to_status_id":null,)";
+            doc += R"("user":{"id":)" + user_id + R"(,"id_str":")" + user_id +
+                   R"(","name":")" + name + R"(","screen_name":")" + name +
+                   R"(","location":")" + src.word() + R"(","description":")" +
+                   src.sentence(src.below(12)) + R"(",)";
+            doc += R"("url":null,"protected":false,"followers_count":)" +
+                   std::to_string(src.below(100000)) + R"(,"friends_count":)" +
+                   std::to_string(src.below(5000)) + R"(,"verified":)" +
+                   (src.below(10) == 0 ? "true" : "false") + ',';
+            doc += R"("profile_image_url":"http:\/\/pbs.twimg.com\/)"
+                   R"(profile_images\/)" +
+                   src.digits(9) + R"(\/normal.jpeg"},)";
+            doc += R"("geo":null,"coordinates":null,"retweet_count":)" +
+                   std::to_string(src.below(50)) + ',';
+            doc += R"("entities":{"hashtags":[)";
+            for (std::uint32_t h = src.below(3); h != 0; --h) {
+                doc += R"({"text":")" + src.word() + R"(","indices":[)" +
+                       std::to_string(src.below(60)) + ',' +
+                       std::to_string(src.below(60) + 60) + "]}";
+                if (h != 1) {
+                    doc += ',';
+                }
+            }
+            doc += R"(],"urls":[],"user_mentions":[]},"favorited":false,)"
+                   R"("retweeted":false,"lang":"ja"})";
+        }
+        doc += R"(],"search_metadata":{"completed_in":0.087,"count":2000}})";
+        return doc;
+    }
+
+    /// A polygon as GeoJSON coordinates: doubles with up to 15 significant
+    /// digits, the hard case for number conversion, plus some integers.
+    std::string make_numbers() {
+        Source src(2);
+        std::string doc = R"({"type":"Polygon","ids":[)";
+        for (int i = 0; i < 5000; ++i) {
+            if (i != 0) {
+                doc += ',';
+            }
+            doc += src.below(2) == 0 ? "-" : "";
+            doc += std::to_string(src.below(1000000));
+        }
+        doc += R"(],"coordinates":[)";
+        for (int i = 0; i < 40000; ++i) {
+            if (i != 0) {
+                doc += ',';
+            }
+            doc += "[-" + std::to_string(src.below(180)) + '.' +
+                   src.digits(src.below(14) + 1) + ',' +
+                   std::to_string(src.below(90)) + '.' +
+                   src.digits(src.below(14) + 1) + ']';
+        }
+        doc += "]}";
+        return doc;
+    }
+
+    /// Chains of objects and arrays 60 levels deep, just inside the default
+    /// max_depth, with small leaves.
+    std::string make_nested() {
+        Source src(3);
+        std::string doc = "[";
+        for (int i = 0; i < 2000; ++i) {
+            if (i != 0) {
+                doc += ',';
+            }
+            std::string close;
+            for (int depth = 0; depth < 60; ++depth) {
+                if (src.below(2) == 0) {
+                    doc += R"({"k":1,"v":)";
+                    close += '}';
+                } else {
+                    doc += "[true,";
+                    close += ']';
+                }
+            }
+            doc += "null";
+            doc.append(close.rbegin(), close.rend());
+        }
+        doc += ']';
+        return doc;
+    }
+
+    /// Strings of 16 KiB, mostly ASCII with some multi-byte UTF-8, where
+    /// the SIMD string scan does nearly all the work.
+    std::string make_long_strings() {
+        Source src(4);
+        std::string doc = "[";
+        for (int i = 0; i < 64; ++i) {
+            if (i != 0) {
+                doc += ',';
+            }
+            doc += '"';
+            std::string str;
+            while (str.size() < 16 * 1024) {
+                str += src.sentence(8);
+                str += ' ';
+            }
+            doc += str;
+            doc += '"';
+        }
+        doc += ']';
+        return doc;
+    }
+
+    /// Strings where most runs are cut short by an escape, including
+    /// \u escapes and surrogate pairs.
+    std::string make_escapes() {
+        static const char *const ESCAPES[] = {
+            R"(\n)",      R"(\t)",      R"(\")",      R"(\\)",
+            R"(\/)",      R"(\r\n)",    R"(\b\f)",    R"(\u00e9)",
+            R"(\u6771)",  R"(\ud83d\ude00)",
+        };
+        constexpr std::uint32_t ESCAPE_COUNT =
+            sizeof(ESCAPES) / sizeof(ESCAPES[0]);
+        Source src(5);
+        std::string doc = "[";
+        for (int i = 0; i < 20000; ++i) {
+            if (i != 0) {
+                doc += ',';
+            }
+            doc += '"';
+            for (std::uint32_t j = src.below(10) + 2; j != 0; --j) {
+                doc += src.word();
+                doc += ESCAPES[src.below(ESCAPE_COUNT)];
+            }
+            doc += '"';
+        }
+        doc += ']';
+        return doc;
+    }
+
+    void report_allocations(benchmark::State &state, std::size_t allocs,
+                            std::size_t bytes) {
+        state.counters["allocs/doc"] = benchmark::Counter(
+            static_cast<double>(allocs), benchmark::Counter::kAvgIterations);
+        state.counters["alloc_bytes/doc"] = benchmark::Counter(
+            static_cast<double>(bytes), benchmark::Counter::kAvgIterations);
+        state.counters["docs/s"] = benchmark::Counter(
+            static_cast<double>(state.iterations()),
+            benchmark::Counter::kIsRate);
+    }
+
+    /// parse() of a whole document, including freeing it.
+    void BM_corpus_parse(benchmark::State &state, bench::Corpus kind) {
+        const std::string &doc = bench::corpus(kind);
+        std::size_t allocs = 0;
+        std::size_t bytes = 0;
+        for (auto _ : state) {
+            std::size_t allocs_before = bench::allocation_count();
+            std::size_t bytes_before = bench::allocation_bytes();
+            {
+                json::JSON_File file = json::parse(std::string_view(doc));
+                benchmark::DoNotOptimize(file.ok());
+            }
+            allocs += bench::allocation_count() - allocs_before;
+            bytes += bench::allocation_bytes() - bytes_before;
+        }
+        report_allocations(state, allocs, bytes);
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                                doc.size());
+    }
+
+    /// to_string() of a parsed document, by bytes of output.
+    void BM_corpus_to_string(benchmark::State &state, bench::Corpus kind) {
+        json::JSON_File file =
+            json::parse(std::string_view(bench::corpus(kind)));
+        std::size_t allocs = 0;
+        std::size_t bytes = 0;
+        std::size_t written = 0;
+        for (auto _ : state) {
+            std::size_t allocs_before = bench::allocation_count();
+            std::size_t bytes_before = bench::allocation_bytes();
+            std::string text = file.get_root()->to_string();
+            allocs += bench::allocation_count() - allocs_before;
+            bytes += bench::allocation_bytes() - bytes_before;
+            written += text.size();
+            benchmark::DoNotOptimize(text.data());
+        }
+        report_allocations(state, allocs, bytes);
+        state.SetBytesProcessed(static_cast<std::int64_t>(written));
+    }
+
+#define CORPUS_BENCHMARKS(name, kind)                                        \
+    BENCHMARK_CAPTURE(BM_corpus_parse, name, bench::Corpus::kind)            \
+        ->Unit(benchmark::kMillisecond);                                     \
+    BENCHMARK_CAPTURE(BM_corpus_to_string, name, bench::Corpus::kind)        \
+        ->Unit(benchmark::kMillisecond)
+
+    CORPUS_BENCHMARKS(twitter, TWITTER);
+    CORPUS_BENCHMARKS(numbers, NUMBERS);
+    CORPUS_BENCHMARKS(nested, NESTED);
+    CORPUS_BENCHMARKS(long_strings, LONG_STRINGS);
+    CORPUS_BENCHMARKS(escapes, ESCAPES);
+
+#undef CORPUS_BENCHMARKS
+} // namespace
+
+namespace bench {
+    const std::string &corpus(Corpus kind) {
+        static const std::string documents[] = {
+            make_twitter(), make_numbers(), make_nested(),
+            make_long_strings(), make_escapes(),
+        };
+        return documents[static_cast<int>(kind)];
+    }
+} // namespace bench
@@ -0,0 +1,63 @@
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "ondemand.h"
+#include "parse.h"
+
+namespace {
+    /// A request-sized document of about 5 KB.
+    std::string make_request() {
+        std::string doc = R"({"meta":{"version":3,"trace":"4bf92f3577b34da6"},)"
+                          R"("items":[)";
+        for (int i = 0; i < 40; ++i) {
+            if (i != 0) {
+                doc += ',';
+            }
+            std::string n = std::to_string(i);
+            doc += R"({"sku":"item-)" + n + R"(","qty":)" + n +
+                   R"(,"price":)" + n + R"(.99,"tags":["x","y"],"gift":false})";
+        }
+        doc += R"(],"user":{"id":12345,"name":"Jane Doe","roles":["a","b"]}})";
+        return doc;
+    }
+
+    const char *const POINTERS[] = {"/user/id", "/user/name", "/meta/version",
+                                    "/items/39/price"};
+
+    void BM_ondemand_pointers(benchmark::State &state) {
+        std::string doc = make_request();
+        for (auto _ : state) {
+            json::OnDemandDocument document(doc);
+            for (const char *pointer : POINTERS) {
+                json::JSON_File value = document.at(pointer);
+                benchmark::DoNotOptimize(value.ok());
+            }
+        }
+        state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()));
+    }
+    BENCHMARK(BM_ondemand_pointers);
+
+    /// The same fields looked up in a full tree, for comparison.
+    void BM_ondemand_full_tree(benchmark::State &state) {
+        std::string doc = make_request();
+        for (auto _ : state) {
+            json::JSON_File file = json::parse(std::string_view(doc));
+            auto *root = static_cast<const json::JSON_Object *>(file.get_root());
+            auto *user =
+                static_cast<const json::JSON_Object *>(root->get("user"));
+            auto *meta =
+                static_cast<const json::JSON_Object *>(root->get("meta"));
+            auto *items =
+                static_cast<const json::JSON_Array *>(root->get("items"));
+            benchmark::DoNotOptimize(user->get("id"));
+            benchmark::DoNotOptimize(user->get("name"));
+            benchmark::DoNotOptimize(meta->get("version"));
+            benchmark::DoNotOptimize(
+                static_cast<const json::JSON_Object *>(items->get(39))
+                    ->get("price"));
+        }
+        state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()));
+    }
+    BENCHMARK(BM_ondemand_full_tree);
+} // namespace
@@ -0,0 +1,54 @@
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "parallel.h"
+
+namespace {
+    std::string make_records(int records) {
+        std::string doc = "[";
+        for (int i = 0; i < records; ++i) {
+            if (i != 0) {
+                doc += ',';
+            }
+            std::string n = std::to_string(i);
+            doc += R"({"id":)" + n + R"(,"name":"user)" + n +
+                   R"(","text":"say \"hi\", [x]","score":)" + n +
+                   R"(.5,"tags":["a","b"],"geo":{"lat":35.6,"lon":139.7}})";
+        }
+        doc += ']';
+        return doc;
+    }
+
+    /// A 20 MB array of records on state.range(0) threads.
+    void BM_parallel_records(benchmark::State &state) {
+        std::string doc = make_records(150000);
+        for (auto _ : state) {
+            json::JSON_File file = json::parse_parallel(
+                doc, static_cast<unsigned>(state.range(0)));
+            benchmark::DoNotOptimize(file.ok());
+        }
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                                doc.size());
+    }
+    BENCHMARK(BM_parallel_records)
+        ->ArgName("threads")
+        ->Arg(1)
+        ->Arg(2)
+        ->Arg(4)
+        ->Arg(8)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+
+    /// The same document parsed sequentially.
+    void BM_parallel_baseline(benchmark::State &state) {
+        std::string doc = make_records(150000);
+        for (auto _ : state) {
+            json::JSON_File file = json::parse(std::string_view(doc));
+            benchmark::DoNotOptimize(file.ok());
+        }
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                                doc.size());
+    }
+    BENCHMARK(BM_parallel_baseline)->Unit(benchmark::kMillisecond);
+} // namespace
@@ -0,0 +1,99 @@
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "parse.h"
+#include "sax.h"
+
+namespace {
+    std::string make_records(int records) {
+        std::string doc = "[";
+        for (int i = 0; i < records; ++i) {
+            if (i != 0) {
+                doc += ',';
+            }
+            std::string n = std::to_string(i);
+            doc += R"({"id":)" + n + R"(,"name":"user)" + n +
+                   R"(","active":true,"score":)" + n + R"(.5,"tags":["a","b"],)"
+                   R"("geo":{"lat":35.6,"lon":139.7},"parent":null})";
+        }
+        doc += ']';
+        return doc;
+    }
+
+    /// Sums every "score" member without building a tree.
+    class ScoreSum {
+        bool in_score_ = false;
+
+    public:
+        double sum = 0;
+
+        bool start_object() { return true; }
+        bool key(std::string_view key) {
+            in_score_ = key == "score";
+            return true;
+        }
+        bool end_object() { return true; }
+        bool start_array() { return true; }
+        bool end_array() { return true; }
+        bool value(std::nullptr_t) { return true; }
+        bool value(bool) { return true; }
+        bool value(std::int64_t n) { return value(static_cast<double>(n)); }
+        bool value(std::uint64_t n) { return value(static_cast<double>(n)); }
+        bool value(double n) {
+            if (in_score_) {
+                sum += n;
+            }
+            return true;
+        }
+        bool value(std::string_view) { return true; }
+    };
+
+    void BM_sax_score_sum(benchmark::State &state) {
+        std::string doc = make_records(10000);
+        for (auto _ : state) {
+            ScoreSum handler;
+            bool ok = json::parse_sax(doc, handler);
+            benchmark::DoNotOptimize(ok);
+            benchmark::DoNotOptimize(handler.sum);
+        }
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                                doc.size());
+    }
+    BENCHMARK(BM_sax_score_sum);
+
+    /// The same document through the tree builder, for comparison.
+    void BM_sax_tree(benchmark::State &state) {
+        std::string doc = make_records(10000);
+        for (auto _ : state) {
+            json::JSON_File file = json::parse(std::string_view(doc));
+            benchmark::DoNotOptimize(file.ok());
+        }
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                                doc.size());
+    }
+    BENCHMARK(BM_sax_tree);
+
+    /// A chain of objects and arrays state.range(0) levels deep, by levels
+    /// per second.  The parser keeps the open levels on heap stacks, so the
+    /// cost per level should not grow with the depth.
+    void BM_sax_deep(benchmark::State &state) {
+        auto depth = static_cast<std::size_t>(state.range(0));
+        std::string doc;
+        for (std::size_t i = 0; i < depth; ++i) {
+            doc += i % 2 == 0 ? R"({"k":)" : "[";
+        }
+        doc += "null";
+        for (std::size_t i = depth; i-- > 0;) {
+            doc += i % 2 == 0 ? '}' : ']';
+        }
+        for (auto _ : state) {
+            json::JSON_File file =
+                json::parse(std::string_view(doc), json::UNLIMITED_DEPTH);
+            benchmark::DoNotOptimize(file.ok());
+        }
+        state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) *
+                                state.range(0));
+    }
+    BENCHMARK(BM_sax_deep)->Arg(32)->Arg(1024)->Arg(100000);
+} // namespace
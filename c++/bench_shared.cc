@@ -0,0 +1,61 @@
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "shared.h"
+
+namespace {
+    /// A catalog of 10000 products, parsed once and read by every thread.
+    const json::SharedDocument &catalog() {
+        static const json::SharedDocument document = [] {
+            std::string doc = R"({"products":[)";
+            for (int i = 0; i < 10000; ++i) {
+                if (i != 0) {
+                    doc += ',';
+                }
+                std::string n = std::to_string(i);
+                doc += R"({"sku":"p-)" + n + R"(","price":)" + n +
+                       R"(.25,"stock":)" + n + R"(,"tags":["a","b"]})";
+            }
+            doc += "]}";
+            return json::SharedDocument(json::parse(std::string_view(doc)));
+        }();
+        return document;
+    }
+
+    double price(const json::SharedDocument &document, std::size_t index) {
+        auto *root =
+            static_cast<const json::JSON_Object *>(document.get_root());
+        auto *products =
+            static_cast<const json::JSON_Array *>(root->get("products"));
+        auto *product = static_cast<const json::JSON_Object *>(
+            products->get(index % products->size()));
+        return static_cast<const json::JSON_Number *>(product->get("price"))
+            ->get_value();
+    }
+
+    /// Lookups from state.threads() threads through one shared reference.
+    void BM_shared_read(benchmark::State &state) {
+        const json::SharedDocument &document = catalog();
+        std::size_t index = static_cast<std::size_t>(state.thread_index());
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(price(document, index));
+            index += 7919;
+        }
+        state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()));
+    }
+    BENCHMARK(BM_shared_read)->ThreadRange(1, 8)->UseRealTime();
+
+    /// The same with a copy of the document per lookup, which makes every
+    /// thread write the reference count.
+    void BM_shared_copy_per_read(benchmark::State &state) {
+        std::size_t index = static_cast<std::size_t>(state.thread_index());
+        for (auto _ : state) {
+            json::SharedDocument document = catalog();
+            benchmark::DoNotOptimize(price(document, index));
+            index += 7919;
+        }
+        state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()));
+    }
+    BENCHMARK(BM_shared_copy_per_read)->ThreadRange(1, 8)->UseRealTime();
+} // namespace
@@ -0,0 +1,88 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "stream.h"
+
+namespace {
+    std::string make_lines(int records) {
+        std::string doc;
+        for (int i = 0; i < records; ++i) {
+            std::string n = std::to_string(i);
+            doc += R"({"id":)" + n + R"(,"name":"user)" + n +
+                   R"(","active":true,"score":)" + n + R"(.5,"tags":["a","b"],)"
+                   R"("geo":{"lat":35.6,"lon":139.7},"parent":null})"
+                   "\n";
+        }
+        return doc;
+    }
+
+    /// One document at a time, reusing a single JSON_File.
+    void BM_stream_sequential(benchmark::State &state) {
+        std::string doc = make_lines(100000);
+        for (auto _ : state) {
+            json::DocumentStream stream(doc);
+            json::JSON_File file;
+            std::size_t count = 0;
+            while (stream.next(&file)) {
+                count += file.ok();
+            }
+            benchmark::DoNotOptimize(count);
+        }
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                                doc.size());
+    }
+    BENCHMARK(BM_stream_sequential)->Unit(benchmark::kMillisecond);
+
+    /// All documents kept in one arena, with keys interned once for all
+    /// of them if state.range(0) is 1.
+    void BM_stream_keep_all(benchmark::State &state) {
+        std::string doc = make_lines(100000);
+        std::size_t bytes = 0;
+        for (auto _ : state) {
+            json::DocumentStream stream(doc);
+            auto keys = std::make_shared<json::KeyInterner>();
+            if (state.range(0) != 0) {
+                stream.set_keys(keys);
+            }
+            json::Arena arena;
+            std::vector<json::JSON_Primitive *> roots;
+            json::JSON_Primitive *root;
+            while (stream.next(arena, &root)) {
+                roots.push_back(root);
+            }
+            benchmark::DoNotOptimize(roots.data());
+            bytes = arena.bytes_reserved() + keys->bytes_reserved();
+        }
+        state.counters["bytes"] = static_cast<double>(bytes);
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                                doc.size());
+    }
+    BENCHMARK(BM_stream_keep_all)
+        ->ArgName("intern")
+        ->Arg(0)
+        ->Arg(1)
+        ->Unit(benchmark::kMillisecond);
+
+    /// All documents kept, parsed on state.range(0) threads.
+    void BM_stream_parallel(benchmark::State &state) {
+        std::string doc = make_lines(100000);
+        for (auto _ : state) {
+            std::vector<json::JSON_File> files = json::parse_ndjson(
+                doc, static_cast<unsigned>(state.range(0)));
+            benchmark::DoNotOptimize(files.data());
+        }
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                                doc.size());
+    }
+    BENCHMARK(BM_stream_parallel)
+        ->ArgName("threads")
+        ->Arg(1)
+        ->Arg(2)
+        ->Arg(4)
+        ->Arg(8)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+} // namespace
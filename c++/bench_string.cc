@@ -0,0 +1,118 @@
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "parse.h"
+
+namespace {
+    std::string make_short_keys(int records) {
+        std::string doc = "[";
+        for (int i = 0; i < records; ++i) {
+            if (i != 0) {
+                doc += ',';
+            }
+            doc += R"({"id":"a","ts":"b","ty":"c","u":"d","v":"e","ok":"f"})";
+        }
+        doc += ']';
+        return doc;
+    }
+
+    std::string make_long_ascii(int values, int length) {
+        std::string doc = "[";
+        for (int i = 0; i < values; ++i) {
+            if (i != 0) {
+                doc += ',';
+            }
+            doc += '"';
+            for (int j = 0; j < length; ++j) {
+                doc += static_cast<char>('a' + (i + j) % 26);
+            }
+            doc += '"';
+        }
+        doc += ']';
+        return doc;
+    }
+
+    std::string make_escape_heavy(int values) {
+        std::string doc = "[";
+        for (int i = 0; i < values; ++i) {
+            if (i != 0) {
+                doc += ',';
+            }
+            doc += R"("C:\\dir\\file.txt\n\t\"quoted\" \u00e9t\u00e9 \/path")";
+        }
+        doc += ']';
+        return doc;
+    }
+
+    /// Strings of `length' bytes mixing ASCII with 2, 3 and 4 byte
+    /// sequences, which JSON_STRICT_UTF8 validates in full.
+    std::string make_utf8(int values, int length) {
+        static const char *const pieces[] = {
+            "abc ", "caf\xc3\xa9 ", "\xe4\xb8\xad\xe6\x96\x87",
+            "\xf0\x9f\x98\x80", "\xd0\x9f\xd1\x80\xd0\xb8",
+        };
+        std::string doc = "[";
+        for (int i = 0; i < values; ++i) {
+            if (i != 0) {
+                doc += ',';
+            }
+            doc += '"';
+            std::size_t start = doc.size();
+            for (int j = i; doc.size() - start < std::size_t(length); ++j) {
+                doc += pieces[j % 5];
+            }
+            doc += '"';
+        }
+        doc += ']';
+        return doc;
+    }
+
+    /// Pairs of \u escapes of surrogates, each decoded to one four byte
+    /// sequence.
+    std::string make_surrogates(int values) {
+        std::string doc = "[";
+        for (int i = 0; i < values; ++i) {
+            if (i != 0) {
+                doc += ',';
+            }
+            doc += R"("\ud83d\ude00 smile \ud834\udd1e clef")";
+        }
+        doc += ']';
+        return doc;
+    }
+
+    void run(benchmark::State &state, const std::string &doc) {
+        for (auto _ : state) {
+            json::JSON_File file = json::parse(std::string_view(doc));
+            benchmark::DoNotOptimize(file.ok());
+        }
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                                doc.size());
+    }
+
+    void BM_string_short_keys(benchmark::State &state) {
+        run(state, make_short_keys(10000));
+    }
+    BENCHMARK(BM_string_short_keys);
+
+    void BM_string_long_ascii(benchmark::State &state) {
+        run(state, make_long_ascii(1000, static_cast<int>(state.range(0))));
+    }
+    BENCHMARK(BM_string_long_ascii)->Arg(64)->Arg(1024)->Arg(16384);
+
+    void BM_string_escape_heavy(benchmark::State &state) {
+        run(state, make_escape_heavy(10000));
+    }
+    BENCHMARK(BM_string_escape_heavy);
+
+    void BM_string_utf8(benchmark::State &state) {
+        run(state, make_utf8(1000, static_cast<int>(state.range(0))));
+    }
+    BENCHMARK(BM_string_utf8)->Arg(16)->Arg(64)->Arg(1024)->Arg(16384);
+
+    void BM_string_surrogates(benchmark::State &state) {
+        run(state, make_surrogates(10000));
+    }
+    BENCHMARK(BM_string_surrogates);
+} // namespace
@@ -0,0 +1,100 @@
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "bench.h"
+#include "parse.h"
+#include "tape.h"
+
+namespace {
+    /// True if `value' on the tape holds what `node' of a tree parsed from
+    /// the same text does.  Recurses, which the corpus is shallow enough
+    /// for.
+    bool same(json::TapeValue value, const json::JSON_Primitive &node) {
+        switch (node.get_type()) {
+        case json::JSON_Type::BOOLEAN:
+            return (value.get_tag() == json::TapeTag::TRUE_VALUE ||
+                    value.get_tag() == json::TapeTag::FALSE_VALUE) &&
+                   value.get_bool() ==
+                       static_cast<const json::JSON_Boolean &>(node)
+                           .get_value();
+        case json::JSON_Type::NUMBER: {
+            auto &number = static_cast<const json::JSON_Number &>(node);
+            switch (number.get_kind()) {
+            case json::JSON_Number::Kind::INT64:
+                return value.get_tag() == json::TapeTag::INT64 &&
+                       value.get_int64() == number.get_int64();
+            case json::JSON_Number::Kind::UINT64:
+                return value.get_tag() == json::TapeTag::UINT64 &&
+                       value.get_uint64() == number.get_uint64();
+            default:
+                return value.get_tag() == json::TapeTag::DOUBLE &&
+                       value.get_double() == number.get_value();
+            }
+        }
+        case json::JSON_Type::STRING:
+            return value.get_tag() == json::TapeTag::STRING &&
+                   value.get_string() ==
+                       static_cast<const json::JSON_String &>(node)
+                           .get_value();
+        case json::JSON_Type::ARRAY: {
+            auto &array = static_cast<const json::JSON_Array &>(node);
+            if (!value.is_array() || value.size() != array.size()) {
+                return false;
+            }
+            const json::JSON_Primitive *const *element = array.begin();
+            for (json::TapeValue item : value.elements()) {
+                if (!same(item, **element++)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        default: {
+            auto &object = static_cast<const json::JSON_Object &>(node);
+            if (object.is_null()) {
+                return value.is_null();
+            }
+            // The tape keeps duplicate keys, which the tree merges.
+            if (!value.is_object() || value.size() < object.size()) {
+                return false;
+            }
+            for (const json::JSON_Member &member : object) {
+                json::TapeValue found = value[member.key];
+                if (!found.valid() || !same(found, *member.value)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        }
+    }
+
+    /// parse_tape() of a corpus document.  The tape is first checked
+    /// against the tree that parse() builds from the same text.
+    void BM_tape_parse(benchmark::State &state, bench::Corpus kind) {
+        const std::string &doc = bench::corpus(kind);
+        json::Tape tape = json::parse_tape(doc);
+        json::JSON_File file = json::parse(std::string_view(doc));
+        if (!tape.ok() || !same(tape.get_root(), *file.get_root())) {
+            state.SkipWithError("the tape does not match the tree");
+            return;
+        }
+
+        for (auto _ : state) {
+            json::Tape tape = json::parse_tape(doc);
+            benchmark::DoNotOptimize(tape.ok());
+        }
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                                doc.size());
+    }
+
+    BENCHMARK_CAPTURE(BM_tape_parse, twitter, bench::Corpus::TWITTER)
+        ->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(BM_tape_parse, numbers, bench::Corpus::NUMBERS)
+        ->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(BM_tape_parse, nested, bench::Corpus::NESTED)
+        ->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(BM_tape_parse, escapes, bench::Corpus::ESCAPES)
+        ->Unit(benchmark::kMillisecond);
+} // namespace
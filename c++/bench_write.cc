@@ -0,0 +1,38 @@
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "parse.h"
+#include "writer.h"
+
+namespace {
+    std::string make_mixed(int records) {
+        std::string doc = "[";
+        for (int i = 0; i < records; ++i) {
+            if (i != 0) {
+                doc += ',';
+            }
+            std::string n = std::to_string(i);
+            doc += R"({"id":)" + n + R"(,"name":"user )" + n +
+                   R"(","note":"line\nbreak \"quoted\"","score":)" + n +
+                   R"(.25,"ratio":0.1,"tags":["a","b"],"ok":true,"p":null})";
+        }
+        doc += ']';
+        return doc;
+    }
+
+    /// Serialization of a parsed tree into one in-memory buffer.
+    void BM_write_mixed(benchmark::State &state) {
+        std::string doc = make_mixed(10000);
+        json::JSON_File file = json::parse(std::string_view(doc));
+        std::size_t written = 0;
+        for (auto _ : state) {
+            json::Writer writer;
+            writer.write(*file.get_root());
+            written += writer.str().size();
+            benchmark::DoNotOptimize(writer.str().data());
+        }
+        state.SetBytesProcessed(static_cast<std::int64_t>(written));
+    }
+    BENCHMARK(BM_write_mixed);
+} // namespace
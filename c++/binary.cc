@@ -0,0 +1,516 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "binary.h"
+#include "sax.h"
+
+namespace json {
+    namespace {
+        const char MAGIC[] = {'\xff', 'J', 'B', 1};
+
+        // Tag bytes; see binary.h.
+        constexpr unsigned char SHORT_STRING = 0x80;
+        constexpr std::size_t SHORT_STRING_MAX = 0x1f;
+        constexpr unsigned char NULL_TAG = 0xa0;
+        constexpr unsigned char FALSE_TAG = 0xa1;
+        constexpr unsigned char TRUE_TAG = 0xa2;
+        constexpr unsigned char INT64_TAG = 0xa3;
+        constexpr unsigned char UINT64_TAG = 0xa4;
+        constexpr unsigned char DOUBLE_TAG = 0xa5;
+        constexpr unsigned char STRING_TAG = 0xa6;
+        constexpr unsigned char ARRAY_TAG = 0xa7;
+        constexpr unsigned char OBJECT_TAG = 0xa8;
+
+        /// Longest varint, for a 64-bit value.
+        constexpr std::size_t MAX_VARINT_SIZE = 10;
+
+        std::uint64_t little_endian(std::uint64_t bits) {
+            if constexpr (std::endian::native == std::endian::big) {
+                return __builtin_bswap64(bits);
+            }
+            return bits;
+        }
+
+        char *put_varint(char *p, std::uint64_t value) {
+            while (value >= 0x80) {
+                *p++ = static_cast<char>(value | 0x80);
+                value >>= 7;
+            }
+            *p++ = static_cast<char>(value);
+            return p;
+        }
+
+        /// Writes a tree back to front, so that the contents of a container
+        /// are done, and their size known, when its header is written.
+        class BinaryEncoder {
+            struct Frame {
+                const JSON_Primitive *container;
+                // Elements or members not written yet, from the front.
+                std::size_t next;
+                // written() when the container was opened.
+                std::size_t mark;
+            };
+
+            std::unique_ptr<char[]> buffer_;
+            std::size_t capacity_ = 0;
+            // The output is buffer_[start_, capacity_).
+            std::size_t start_ = 0;
+            std::vector<Frame> frames_;
+
+            std::size_t written() const { return capacity_ - start_; }
+
+            char *prepend(std::size_t size) {
+                if (start_ < size) {
+                    std::size_t capacity =
+                        std::max(2 * capacity_, written() + size + 4096);
+                    auto buffer = std::make_unique_for_overwrite<char[]>(
+                        capacity);
+                    if (buffer_ != nullptr) {
+                        std::memcpy(buffer.get() + capacity - written(),
+                                    buffer_.get() + start_, written());
+                    }
+                    start_ += capacity - capacity_;
+                    capacity_ = capacity;
+                    buffer_ = std::move(buffer);
+                }
+                start_ -= size;
+                return buffer_.get() + start_;
+            }
+
+            void prepend(const char *data, std::size_t size) {
+                std::memcpy(prepend(size), data, size);
+            }
+
+            void put_string(std::string_view str) {
+                if (!str.empty()) {
+                    prepend(str.data(), str.size());
+                }
+                char head[1 + MAX_VARINT_SIZE];
+                char *p = head;
+                if (str.size() <= SHORT_STRING_MAX) {
+                    *p++ = static_cast<char>(SHORT_STRING | str.size());
+                } else {
+                    *p++ = static_cast<char>(STRING_TAG);
+                    p = put_varint(p, str.size());
+                }
+                prepend(head, p - head);
+            }
+
+            void put_header(unsigned char tag, std::size_t count,
+                            std::size_t mark) {
+                char head[1 + 2 * MAX_VARINT_SIZE];
+                char *p = head;
+                *p++ = static_cast<char>(tag);
+                p = put_varint(p, count);
+                p = put_varint(p, written() - mark);
+                prepend(head, p - head);
+            }
+
+            void put_number(const JSON_Number &number) {
+                char head[1 + MAX_VARINT_SIZE];
+                char *p = head;
+                switch (number.get_kind()) {
+                case JSON_Number::Kind::INT64: {
+                    std::int64_t n = number.get_int64();
+                    if (n >= 0 && n < SHORT_STRING) {
+                        *p++ = static_cast<char>(n);
+                        break;
+                    }
+                    *p++ = static_cast<char>(INT64_TAG);
+                    auto bits = static_cast<std::uint64_t>(n);
+                    p = put_varint(p, bits << 1 ^ -(bits >> 63));
+                    break;
+                }
+                case JSON_Number::Kind::UINT64:
+                    *p++ = static_cast<char>(UINT64_TAG);
+                    p = put_varint(p, number.get_uint64());
+                    break;
+                default: {
+                    *p++ = static_cast<char>(DOUBLE_TAG);
+                    std::uint64_t bits = little_endian(
+                        std::bit_cast<std::uint64_t>(number.get_value()));
+                    std::memcpy(p, &bits, 8);
+                    p += 8;
+                    break;
+                }
+                }
+                prepend(head, p - head);
+            }
+
+            void put_scalar(const JSON_Primitive &value) {
+                switch (value.get_type()) {
+                case JSON_Type::BOOLEAN:
+                    *prepend(1) = static_cast<char>(
+                        static_cast<const JSON_Boolean &>(value).get_value()
+                            ? TRUE_TAG
+                            : FALSE_TAG);
+                    break;
+                case JSON_Type::NUMBER:
+                    put_number(static_cast<const JSON_Number &>(value));
+                    break;
+                case JSON_Type::STRING:
+                    put_string(
+                        static_cast<const JSON_String &>(value).get_value());
+                    break;
+                default:
+                    // Only the null object gets here.
+                    *prepend(1) = static_cast<char>(NULL_TAG);
+                    break;
+                }
+            }
+
+        public:
+            void write(const JSON_Primitive &root) {
+                const JSON_Primitive *value = &root;
+                for (;;) {
+                    if (value->get_type() == JSON_Type::ARRAY) {
+                        auto *array = static_cast<const JSON_Array *>(value);
+                        frames_.push_back({value, array->size(), written()});
+                    } else if (value->get_type() == JSON_Type::OBJECT &&
+                               !static_cast<const JSON_Object *>(value)
+                                    ->is_null()) {
+                        auto *object = static_cast<const JSON_Object *>(value);
+                        frames_.push_back({value, object->size(), written()});
+                    } else {
+                        put_scalar(*value);
+                    }
+
+                    // Find the previous value to write, closing finished
+                    // containers.
+                    value = nullptr;
+                    while (value == nullptr && !frames_.empty()) {
+                        Frame &frame = frames_.back();
+                        if (frame.container->get_type() == JSON_Type::ARRAY) {
+                            auto *array =
+                                static_cast<const JSON_Array *>(frame.container);
+                            if (frame.next == 0) {
+                                put_header(ARRAY_TAG, array->size(),
+                                           frame.mark);
+                                frames_.pop_back();
+                                continue;
+                            }
+                            value = array->get(--frame.next);
+                        } else {
+                            auto *object = static_cast<const JSON_Object *>(
+                                frame.container);
+                            // The value of member `next' has been written,
+                            // unless no member has.
+                            if (frame.next != object->size()) {
+                                put_string(object->begin()[frame.next].key);
+                            }
+                            if (frame.next == 0) {
+                                put_header(OBJECT_TAG, object->size(),
+                                           frame.mark);
+                                frames_.pop_back();
+                                continue;
+                            }
+                            value = object->begin()[--frame.next].value;
+                        }
+                    }
+                    if (value == nullptr) {
+                        return;
+                    }
+                }
+            }
+
+            std::string_view output() const {
+                return {buffer_.get() + start_, written()};
+            }
+        };
+    } // namespace
+
+    namespace detail {
+        BinaryDecoder::BinaryDecoder()
+            : validate_utf8_(select_kernels().validate_utf8) {}
+
+        bool BinaryDecoder::fail(ParseErrorCode code, const char *at) {
+            error_.code = code;
+            error_.offset = static_cast<std::size_t>(at - begin_);
+            return false;
+        }
+
+        /// For a read that would pass limit_: the input is cut off, or a
+        /// container is shorter than what it holds.
+        bool BinaryDecoder::overrun() {
+            if (limit_ == end_) {
+                return fail(ParseErrorCode::UNEXPECTED_END, end_);
+            }
+            return fail(ParseErrorCode::INVALID_BINARY, p_);
+        }
+
+        bool BinaryDecoder::read_varint(std::uint64_t *value) {
+            std::uint64_t result = 0;
+            for (int shift = 0;; shift += 7) {
+                if (p_ == limit_) {
+                    return overrun();
+                }
+                auto byte = static_cast<unsigned char>(*p_++);
+                if (shift == 63 && byte > 1) {
+                    return fail(ParseErrorCode::INVALID_BINARY, p_ - 1);
+                }
+                result |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+                if (byte < 0x80) {
+                    *value = result;
+                    return true;
+                }
+            }
+        }
+
+        bool BinaryDecoder::read_string(unsigned char tag,
+                                        std::string_view *str) {
+            std::uint64_t size = tag & SHORT_STRING_MAX;
+            if (tag == STRING_TAG && !read_varint(&size)) {
+                return false;
+            }
+            if (size > static_cast<std::uint64_t>(limit_ - p_)) {
+                return overrun();
+            }
+            const char *start = p_;
+            p_ += size;
+            if (JSON_STRICT_UTF8 && !short_ascii(start, size)) {
+                std::size_t valid = validate_utf8_(start, p_);
+                if (valid != size) {
+                    return fail(ParseErrorCode::INVALID_UTF8, start + valid);
+                }
+            }
+            *str = std::string_view(start, size);
+            return true;
+        }
+
+        /// Reads the count and byte length of a container whose items
+        /// take at least `min_size' bytes each.
+        bool BinaryDecoder::read_header(std::uint64_t *count,
+                                        std::uint64_t *length,
+                                        std::uint64_t min_size) {
+            const char *at = p_;
+            if (!read_varint(count) || !read_varint(length)) {
+                return false;
+            }
+            if (*length > static_cast<std::uint64_t>(limit_ - p_)) {
+                return overrun();
+            }
+            // This also bounds what is allocated for the container by the
+            // size of the input.
+            if (*count > *length || *count * min_size > *length ||
+                (*count == 0 && *length != 0)) {
+                return fail(ParseErrorCode::INVALID_BINARY, at);
+            }
+            return true;
+        }
+
+        bool BinaryDecoder::read_value(JSON_Primitive **root) {
+            Frame *top = nullptr;
+            for (;;) {
+                if (top != nullptr && top->object != nullptr) {
+                    if (p_ == limit_) {
+                        return overrun();
+                    }
+                    auto tag = static_cast<unsigned char>(*p_);
+                    if ((tag < SHORT_STRING || tag >= NULL_TAG) &&
+                        tag != STRING_TAG) {
+                        return fail(ParseErrorCode::INVALID_BINARY, p_);
+                    }
+                    ++p_;
+                    if (!read_string(tag, &top->member->key)) {
+                        return false;
+                    }
+                }
+
+                if (p_ == limit_) {
+                    return overrun();
+                }
+                const char *at = p_;
+                auto tag = static_cast<unsigned char>(*p_++);
+                JSON_Primitive *node;
+                Frame frame{};
+                if (tag < SHORT_STRING) {
+                    node = arena_->make<JSON_Number>(
+                        static_cast<std::int64_t>(tag));
+                } else if (tag < NULL_TAG) {
+                    std::string_view str;
+                    if (!read_string(tag, &str)) {
+                        return false;
+                    }
+                    node = arena_->make<JSON_String>(str);
+                } else {
+                    std::uint64_t bits;
+                    std::uint64_t count;
+                    std::uint64_t length;
+                    switch (tag) {
+                    case NULL_TAG:
+                        node = arena_->make<JSON_Object>(true);
+                        break;
+                    case FALSE_TAG:
+                    case TRUE_TAG:
+                        node = arena_->make<JSON_Boolean>(tag == TRUE_TAG);
+                        break;
+                    case INT64_TAG:
+                        if (!read_varint(&bits)) {
+                            return false;
+                        }
+                        node = arena_->make<JSON_Number>(
+                            static_cast<std::int64_t>(bits >> 1 ^
+                                                      -(bits & 1)));
+                        break;
+                    case UINT64_TAG:
+                        if (!read_varint(&bits)) {
+                            return false;
+                        }
+                        node = arena_->make<JSON_Number>(bits);
+                        break;
+                    case DOUBLE_TAG:
+                        if (limit_ - p_ < 8) {
+                            return overrun();
+                        }
+                        std::memcpy(&bits, p_, 8);
+                        p_ += 8;
+                        node = arena_->make<JSON_Number>(
+                            std::bit_cast<double>(little_endian(bits)));
+                        break;
+                    case STRING_TAG: {
+                        std::string_view str;
+                        if (!read_string(tag, &str)) {
+                            return false;
+                        }
+                        node = arena_->make<JSON_String>(str);
+                        break;
+                    }
+                    case ARRAY_TAG: {
+                        if (!read_header(&count, &length, 1)) {
+                            return false;
+                        }
+                        auto **elements = static_cast<JSON_Primitive **>(
+                            arena_->allocate_raw(
+                                count * sizeof(JSON_Primitive *),
+                                alignof(JSON_Primitive *)));
+                        node = arena_->make<JSON_Array>(elements, count);
+                        frame = {p_ + length, count,   elements,
+                                 nullptr,     nullptr, nullptr};
+                        break;
+                    }
+                    case OBJECT_TAG: {
+                        if (!read_header(&count, &length, 2)) {
+                            return false;
+                        }
+                        auto *members = static_cast<JSON_Member *>(
+                            arena_->allocate_raw(count * sizeof(JSON_Member),
+                                                 alignof(JSON_Member)));
+                        auto *object = arena_->make<JSON_Object>(arena_);
+                        node = object;
+                        frame = {p_ + length, count,   nullptr,
+                                 object,      members, members};
+                        break;
+                    }
+                    default:
+                        return fail(ParseErrorCode::INVALID_BINARY, at);
+                    }
+                }
+
+                if (top == nullptr) {
+                    *root = node;
+                } else {
+                    --top->remaining;
+                    if (top->object == nullptr) {
+                        *top->element++ = node;
+                    } else {
+                        top->member++->value = node;
+                    }
+                }
+                if (frame.remaining != 0) {
+                    frames_.push_back(frame);
+                    top = &frames_.back();
+                    limit_ = top->end;
+                    continue;
+                }
+
+                // Close the containers that are complete.
+                while (top != nullptr && top->remaining == 0) {
+                    if (p_ != top->end) {
+                        return fail(ParseErrorCode::INVALID_BINARY, p_);
+                    }
+                    if (top->object != nullptr) {
+                        top->object->adopt(top->members,
+                                           top->member - top->members);
+                    }
+                    frames_.pop_back();
+                    top = frames_.empty() ? nullptr : &frames_.back();
+                    limit_ = top != nullptr ? top->end : end_;
+                }
+                if (top == nullptr) {
+                    return true;
+                }
+            }
+        }
+
+        bool BinaryDecoder::read_document(JSON_Primitive **root) {
+            std::size_t size = end_ - begin_;
+            if (size == 0) {
+                return fail(ParseErrorCode::EMPTY_INPUT, begin_);
+            }
+            std::size_t header = std::min(size, sizeof(MAGIC));
+            if (std::memcmp(begin_, MAGIC, header) != 0) {
+                return fail(ParseErrorCode::INVALID_BINARY, begin_);
+            } else if (header < sizeof(MAGIC)) {
+                return fail(ParseErrorCode::UNEXPECTED_END, end_);
+            }
+            p_ += sizeof(MAGIC);
+            if (!read_value(root)) {
+                return false;
+            } else if (p_ != end_) {
+                return fail(ParseErrorCode::TRAILING_CONTENT, p_);
+            }
+            return true;
+        }
+
+        void BinaryDecoder::decode(std::string_view input, bool borrow,
+                                   JSON_File *file) {
+            arena_ = &file->get_arena();
+            if (!borrow) {
+                input = arena_->copy(input);
+            }
+            begin_ = input.data();
+            end_ = input.data() + input.size();
+            p_ = begin_;
+            limit_ = end_;
+            frames_.clear();
+            error_ = ParseError();
+
+            JSON_Primitive *root = nullptr;
+            if (read_document(&root)) {
+                file->set_root(root);
+            } else {
+                file->set_error(error_);
+            }
+        }
+    } // namespace detail
+
+    void write_binary(std::string *out, const JSON_Primitive &root) {
+        BinaryEncoder encoder;
+        encoder.write(root);
+        std::string_view output = encoder.output();
+        out->reserve(out->size() + sizeof(MAGIC) + output.size());
+        out->append(MAGIC, sizeof(MAGIC));
+        out->append(output);
+    }
+
+    std::string to_binary(const JSON_Primitive &root) {
+        std::string out;
+        write_binary(&out, root);
+        return out;
+    }
+
+    JSON_File parse_binary(std::string_view input) {
+        JSON_File result;
+        detail::BinaryDecoder().decode(input, false, &result);
+        return result;
+    }
+
+    JSON_File parse_binary_borrowed(std::string_view input) {
+        JSON_File result;
+        detail::BinaryDecoder().decode(input, true, &result);
+        return result;
+    }
+} // namespace json
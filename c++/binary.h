@@ -0,0 +1,122 @@
+/* -*- mode: c++ -*- */
+#ifndef BINARY_H
+#define BINARY_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "parse.h"
+#include "scan.h"
+
+namespace json {
+    /// A compact binary form of a JSON_Primitive tree, for caching parsed
+    /// documents.  Reading it back needs no scanning, unescaping or number
+    /// conversion, so it is several times faster than parsing the JSON
+    /// text.  The layout, in the style of MessagePack, is the four bytes
+    /// FF 'J' 'B' 01 (FF never occurs in JSON text, and 01 is the version)
+    /// followed by the root value.  A value starts with a tag byte:
+    ///
+    ///  - 00-7F: an integer 0-127 (Kind::INT64).
+    ///  - 80-9F: a string of 0-31 bytes, which follow.
+    ///  - A0, A1, A2: null, false, true.
+    ///  - A3: an integer of Kind::INT64, as a zigzag varint.
+    ///  - A4: an integer of Kind::UINT64, as a varint.
+    ///  - A5: a double, as 8 bytes.
+    ///  - A6: a string, as a varint length and the bytes.
+    ///  - A7: an array, as a varint element count, a varint byte length of
+    ///    the elements and the elements.
+    ///  - A8: an object, likewise, but with a string (80-9F or A6) for the
+    ///    key before every value.
+    ///
+    /// Varints are little-endian base 128 (LEB128), and doubles are stored
+    /// little-endian, as are their bits in memory on x86.  The byte length
+    /// of containers lets a reader skip a subtree without looking at it.
+    /// Doubles keep their exact bits, so infinities and NaNs, which the
+    /// Writer turns into null, survive.
+
+    /// Appends the binary form of the subtree under `root' to `out'.  The
+    /// output is built from its end, so that the byte length of every
+    /// container is known when its header is written, and copied to `out'
+    /// in one piece.
+    void write_binary(std::string *out, const JSON_Primitive &root);
+
+    /// The binary form of the subtree under `root'.
+    std::string to_binary(const JSON_Primitive &root);
+
+    /// Loads a document written by write_binary().  The input is copied
+    /// into the document's arena in one piece, and strings and keys point
+    /// into the copy.  Nothing about the input is
+    /// trusted: it is checked as strictly as JSON text, down to the UTF-8
+    /// of strings unless JSON_STRICT_UTF8 is off (see sax.h), and a
+    /// container whose contents do not fill its byte length exactly fails
+    /// with INVALID_BINARY.  Errors have an offset but no line or column.
+    /// Nesting is not limited, as the decoder keeps open containers on a
+    /// heap stack, and every level takes at least three bytes of input.
+    /// To load many documents, use a Parser, which keeps the memory.
+    JSON_File parse_binary(std::string_view input);
+
+    /// Like parse_binary(), but strings and keys are views into `input',
+    /// which must outlive the returned JSON_File.
+    JSON_File parse_binary_borrowed(std::string_view input);
+} // namespace json
+
+namespace json::detail {
+    /// Builds a tree from the binary form.  Since every container states
+    /// its size up front, the elements of arrays and the members of
+    /// objects are allocated at their final size and filled in place,
+    /// without the scratch stacks of a TreeBuilder.  Only the stack of
+    /// open containers is kept between documents.
+    class BinaryDecoder {
+        struct Frame {
+            // The end of the contents.
+            const char *end;
+            // Elements or members not read yet.
+            std::uint64_t remaining;
+            // The next element of an array, or null for an object.
+            JSON_Primitive **element;
+            // The object, its members and the next one, or null for an
+            // array.
+            JSON_Object *object;
+            JSON_Member *members;
+            JSON_Member *member;
+        };
+
+        Arena *arena_ = nullptr;
+        const char *begin_ = nullptr;
+        const char *end_ = nullptr;
+        const char *p_ = nullptr;
+        // The end of the innermost open container, or of the input.
+        const char *limit_ = nullptr;
+        Utf8ValidateFn validate_utf8_;
+        std::vector<Frame> frames_;
+        ParseError error_;
+
+        bool fail(ParseErrorCode code, const char *at);
+        bool overrun();
+        bool read_varint(std::uint64_t *value);
+        bool read_string(unsigned char tag, std::string_view *str);
+        bool read_header(std::uint64_t *count, std::uint64_t *length,
+                         std::uint64_t min_size);
+        bool read_value(JSON_Primitive **root);
+        bool read_document(JSON_Primitive **root);
+
+    public:
+        BinaryDecoder();
+
+        /// Loads `input' into `file', which must be empty.  Strings point
+        /// into `input' if `borrow', else into a copy of it in the arena.
+        void decode(std::string_view input, bool borrow, JSON_File *file);
+
+        /// Bytes held by the stack of open containers.
+        std::size_t scratch_bytes() const {
+            return frames_.capacity() * sizeof(Frame);
+        }
+
+        /// Frees the stack of open containers.
+        void release_scratch() { std::vector<Frame>().swap(frames_); }
+    };
+} // namespace json::detail
+
+#endif
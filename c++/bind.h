@@ -0,0 +1,595 @@
+/* -*- mode: c++ -*- */
+#ifndef BIND_H
+#define BIND_H
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "parse.h"
+#include "sax.h"
+#include "writer.h"
+
+// Reading documents straight into C++ structs and writing them back.  A
+// struct is made bindable by specializing json::Record with a tuple of its
+// fields:
+//
+//   struct Point {
+//       double x = 0;
+//       double y = 0;
+//       std::optional<std::string> label;
+//       std::vector<int> tags;
+//   };
+//
+//   template <> struct json::Record<Point> {
+//       static constexpr auto fields = std::make_tuple(
+//           json::field("x", &Point::x), json::field("y", &Point::y),
+//           json::field("label", &Point::label),
+//           json::field("tags", &Point::tags));
+//   };
+//
+// after which parse_into() fills a Point from text and serialize() turns
+// one into text.  Fields may be bool, integers, floating point,
+// std::string, other records, and std::optional and std::vector of any of
+// these.
+
+namespace json {
+    /// Specialize with a `static constexpr' tuple `fields' of field()s.
+    template <typename T> struct Record;
+
+    template <typename T, typename M> struct Field {
+        std::string_view name;
+        M T::*member;
+    };
+
+    /// Maps the member `member' to the key `name', which must not need
+    /// escaping.
+    template <typename T, typename M>
+    constexpr Field<T, M> field(std::string_view name, M T::*member) {
+        return {name, member};
+    }
+} // namespace json
+
+namespace json::detail {
+    template <typename T> struct IsOptional : std::false_type {};
+    template <typename T>
+    struct IsOptional<std::optional<T>> : std::true_type {};
+
+    template <typename T> struct IsVector : std::false_type {};
+    template <typename T, typename A>
+    struct IsVector<std::vector<T, A>> : std::true_type {};
+
+    template <typename T>
+    concept RecordType = requires { Record<T>::fields; };
+
+    /// The length and first, middle and last bytes of `key' in one word,
+    /// which tells most sets of names apart.
+    constexpr std::uint32_t key_sample(std::string_view key) {
+        std::uint32_t sample = static_cast<std::uint32_t>(key.size()) & 0xff;
+        if (!key.empty()) {
+            sample |= static_cast<std::uint32_t>(
+                          static_cast<unsigned char>(key.front()))
+                      << 8;
+            sample |= static_cast<std::uint32_t>(
+                          static_cast<unsigned char>(key[key.size() / 2]))
+                      << 16;
+            sample |= static_cast<std::uint32_t>(
+                          static_cast<unsigned char>(key.back()))
+                      << 24;
+        }
+        return sample;
+    }
+
+    /// FNV-1a, for names that key_sample() cannot tell apart.
+    constexpr std::uint32_t key_fnv(std::string_view key) {
+        std::uint32_t hash = 0x811c9dc5;
+        for (char c : key) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 0x01000193;
+        }
+        return hash;
+    }
+
+    /// A perfect hash of the keys of N fields: every key lands in a slot
+    /// of its own, so a lookup is one multiplication and one comparison.
+    template <std::size_t N> struct KeyTable {
+        static constexpr std::size_t MIN_SLOTS =
+            std::max<std::size_t>(2, std::bit_ceil(2 * N));
+        // A load factor of 1/8, the sparsest that is tried.
+        static constexpr std::size_t MAX_SLOTS = 4 * MIN_SLOTS;
+
+        std::array<std::string_view, N> names{};
+        // Whether names are told apart by key_fnv() instead of
+        // key_sample().
+        bool fnv = false;
+        std::uint32_t multiplier = 1;
+        int shift = 31;
+        // Field index + 1; 0 marks an empty slot.
+        std::array<std::uint16_t, MAX_SLOTS> slots{};
+
+        constexpr std::size_t slot(std::string_view key) const {
+            std::uint32_t hash = fnv ? key_fnv(key) : key_sample(key);
+            return (hash * multiplier) >> shift;
+        }
+
+        /// The index of the field named `key', or -1.
+        int find(std::string_view key) const {
+            std::size_t index = slots[slot(key)];
+            if (index == 0 || names[index - 1] != key) {
+                return -1;
+            }
+            return static_cast<int>(index - 1);
+        }
+    };
+
+    /// Searches multipliers and table sizes until the keys do not
+    /// collide, starting from a load factor of 1/2.
+    template <std::size_t N>
+    consteval KeyTable<N>
+    make_key_table(const std::array<std::string_view, N> &names) {
+        static_assert(N < 0xffff, "too many fields");
+        KeyTable<N> table;
+        table.names = names;
+        for (std::size_t i = 0; i < N; ++i) {
+            for (std::size_t j = 0; j < i; ++j) {
+                if (names[i] == names[j]) {
+                    // Not a constant expression, so this fails to compile.
+                    throw "json::Record has duplicate field names";
+                }
+                if (key_sample(names[i]) == key_sample(names[j])) {
+                    table.fnv = true;
+                }
+            }
+        }
+        for (std::size_t size = KeyTable<N>::MIN_SLOTS;
+             size <= KeyTable<N>::MAX_SLOTS; size *= 2) {
+            table.shift = 32 - std::countr_zero(size);
+            // Odd multipliers, from one with well-mixed bits.
+            for (std::uint32_t multiplier = 0x9e3779b1;
+                 multiplier < 0x9e3779b1 + 8192; multiplier += 2) {
+                table.multiplier = multiplier;
+                table.slots = {};
+                bool collided = false;
+                for (std::size_t i = 0; i < N && !collided; ++i) {
+                    std::uint16_t &slot = table.slots[table.slot(names[i])];
+                    collided = slot != 0;
+                    slot = static_cast<std::uint16_t>(i + 1);
+                }
+                if (!collided) {
+                    return table;
+                }
+            }
+        }
+        throw "json::Record field names could not be hashed";
+    }
+
+    constexpr bool needs_escape(std::string_view name) {
+        for (char c : name) {
+            if (c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <RecordType T> struct RecordKeys {
+        static constexpr std::size_t N =
+            std::tuple_size_v<std::remove_cvref_t<decltype(Record<T>::fields)>>;
+
+        static constexpr KeyTable<N> table = make_key_table<N>(
+            std::apply([](const auto &...fields) {
+                return std::array<std::string_view, N>{fields.name...};
+            }, Record<T>::fields));
+
+        static_assert(
+            std::apply([](const auto &...fields) {
+                return !(needs_escape(fields.name) || ...);
+            }, Record<T>::fields),
+            "json::Record field names must not need escaping");
+    };
+
+    /// The recursive descent behind parse_into().  Each read() starts at
+    /// the first token of a value and stops at its last, and tokens are
+    /// only turned into values of the target types, never into nodes.
+    class BindReader {
+        std::string_view input_;
+        Lexer lexer_;
+        // The current token, copied out field by field: copying a whole
+        // Token is a block move that costs more than the fields.
+        TokenType type_ = TokenType::NULL_OBJ;
+        std::string_view text_;
+        JSON_Number number_{0.0};
+        TokenResult::Error end_ = TokenResult::Error::END;
+        int max_depth_;
+        // Open containers around the current token.
+        int depth_ = 0;
+        // Checks the values of unknown keys, which are skipped.
+        NullHandler null_handler_;
+        Grammar<NullHandler> skipper_;
+        ParseErrorCode error_ = ParseErrorCode::NONE;
+        const char *error_at_ = nullptr;
+
+        bool fail(ParseErrorCode code) {
+            error_ = code;
+            error_at_ = lexer_.token_start();
+            return false;
+        }
+
+        /// Records why the lexer stopped.
+        bool lexer_failed(const TokenResult &tk) {
+            end_ = tk.get_error();
+            if (end_ == TokenResult::Error::END) {
+                error_ = ParseErrorCode::UNEXPECTED_END;
+                error_at_ = lexer_.position();
+            } else {
+                error_ = lexer_.error();
+                error_at_ = lexer_.error_position();
+            }
+            return false;
+        }
+
+        bool advance() {
+            TokenResult tk = lexer_.next();
+            if (!tk) {
+                return lexer_failed(tk);
+            }
+            const Token &token = *tk;
+            type_ = token.get_type();
+            text_ = token.get_token();
+            if (type_ == TokenType::NUMBER) {
+                number_ = token.parse_number();
+            }
+            return true;
+        }
+
+        /// Enters a container, with the depth limit of Grammar::open().
+        bool open() {
+            if (max_depth_ <= depth_ + 1) {
+                return fail(ParseErrorCode::TOO_DEEP);
+            }
+            ++depth_;
+            return true;
+        }
+
+        /// Checks the value at the current token and moves to its end.
+        bool skip() {
+            switch (type_) {
+            case TokenType::STRING:
+            case TokenType::NUMBER:
+            case TokenType::TRUE:
+            case TokenType::FALSE:
+            case TokenType::NULL_OBJ:
+                return true;
+            default:
+                break;
+            }
+            skipper_.reset(max_depth_ - depth_);
+            Token first(type_, text_);
+            if (!skipper_.next(first)) {
+                return fail(skipper_.error());
+            }
+            while (!skipper_.done()) {
+                TokenResult tk = lexer_.next();
+                if (!tk) {
+                    return lexer_failed(tk);
+                }
+                if (!skipper_.next(*tk)) {
+                    return fail(skipper_.error());
+                }
+            }
+            return true;
+        }
+
+        template <typename T, std::size_t... I>
+        bool read_field(T &out, int index, std::index_sequence<I...>) {
+            bool ok = false;
+            (void)((index == static_cast<int>(I) &&
+                    (ok = read(out.*std::get<I>(Record<T>::fields).member),
+                     true)) ||
+                   ...);
+            return ok;
+        }
+
+        template <typename T> bool read_object(T &out) {
+            using Keys = RecordKeys<T>;
+            if (type_ != TokenType::OBJ_OPEN) {
+                return fail(ParseErrorCode::TYPE_MISMATCH);
+            }
+            if (!open() || !advance()) {
+                return false;
+            }
+            if (type_ == TokenType::OBJ_CLOSE) {
+                --depth_;
+                return true;
+            }
+            for (;;) {
+                if (type_ != TokenType::STRING) {
+                    return fail(ParseErrorCode::UNEXPECTED_TOKEN);
+                }
+                // Before the key, which may be in the lexer's scratch
+                // buffer, is overwritten.
+                int index = Keys::table.find(text_);
+                if (!advance()) {
+                    return false;
+                }
+                if (type_ != TokenType::COLON) {
+                    return fail(ParseErrorCode::UNEXPECTED_TOKEN);
+                }
+                if (!advance()) {
+                    return false;
+                }
+                if (index < 0 ? !skip()
+                              : !read_field(out, index,
+                                            std::make_index_sequence<
+                                                Keys::N>())) {
+                    return false;
+                }
+                if (!advance()) {
+                    return false;
+                }
+                if (type_ == TokenType::OBJ_CLOSE) {
+                    --depth_;
+                    return true;
+                }
+                if (type_ != TokenType::COMMA) {
+                    return fail(ParseErrorCode::UNEXPECTED_TOKEN);
+                }
+                if (!advance()) {
+                    return false;
+                }
+            }
+        }
+
+        template <typename T> bool read_array(T &out) {
+            if (type_ != TokenType::ARRAY_OPEN) {
+                return fail(ParseErrorCode::TYPE_MISMATCH);
+            }
+            out.clear();
+            if (!open() || !advance()) {
+                return false;
+            }
+            if (type_ == TokenType::ARRAY_CLOSE) {
+                --depth_;
+                return true;
+            }
+            for (;;) {
+                if constexpr (std::is_same_v<typename T::value_type, bool>) {
+                    // std::vector<bool> has no references to its elements.
+                    bool element;
+                    if (!read(element)) {
+                        return false;
+                    }
+                    out.push_back(element);
+                } else if (!read(out.emplace_back())) {
+                    return false;
+                }
+                if (!advance()) {
+                    return false;
+                }
+                if (type_ == TokenType::ARRAY_CLOSE) {
+                    --depth_;
+                    return true;
+                }
+                if (type_ != TokenType::COMMA) {
+                    return fail(ParseErrorCode::UNEXPECTED_TOKEN);
+                }
+                if (!advance()) {
+                    return false;
+                }
+            }
+        }
+
+        template <typename T> bool read_integer(T &out) {
+            if (type_ != TokenType::NUMBER) {
+                return fail(ParseErrorCode::TYPE_MISMATCH);
+            }
+            const JSON_Number &number = number_;
+            bool in_range;
+            switch (number.get_kind()) {
+            case JSON_Number::Kind::INT64:
+                in_range = std::in_range<T>(number.get_int64());
+                out = static_cast<T>(number.get_int64());
+                break;
+            case JSON_Number::Kind::UINT64:
+                in_range = std::in_range<T>(number.get_uint64());
+                out = static_cast<T>(number.get_uint64());
+                break;
+            default:
+                return fail(ParseErrorCode::TYPE_MISMATCH);
+            }
+            return in_range || fail(ParseErrorCode::NUMBER_OUT_OF_RANGE);
+        }
+
+    public:
+        /// max_depth has the meaning documented for json::parse().
+        BindReader(std::string_view input, int max_depth)
+            : input_(input), lexer_(input), max_depth_(max_depth),
+              skipper_(null_handler_, max_depth) {}
+
+        BindReader(const BindReader &) = delete;
+        BindReader &operator=(const BindReader &) = delete;
+
+        template <typename T> bool read(T &out) {
+            if constexpr (std::is_same_v<T, bool>) {
+                if (type_ != TokenType::TRUE && type_ != TokenType::FALSE) {
+                    return fail(ParseErrorCode::TYPE_MISMATCH);
+                }
+                out = type_ == TokenType::TRUE;
+                return true;
+            } else if constexpr (std::is_integral_v<T>) {
+                return read_integer(out);
+            } else if constexpr (std::is_floating_point_v<T>) {
+                if (type_ != TokenType::NUMBER) {
+                    return fail(ParseErrorCode::TYPE_MISMATCH);
+                }
+                out = static_cast<T>(number_.get_value());
+                return true;
+            } else if constexpr (std::is_same_v<T, std::string>) {
+                if (type_ != TokenType::STRING) {
+                    return fail(ParseErrorCode::TYPE_MISMATCH);
+                }
+                out.assign(text_);
+                return true;
+            } else if constexpr (IsOptional<T>::value) {
+                if (type_ == TokenType::NULL_OBJ) {
+                    out.reset();
+                    return true;
+                }
+                return read(out.emplace());
+            } else if constexpr (IsVector<T>::value) {
+                return read_array(out);
+            } else {
+                static_assert(RecordType<T>,
+                              "parse_into() needs a json::Record for T");
+                return read_object(out);
+            }
+        }
+
+        /// Reads the single value that must make up the input.
+        template <typename T> bool read_document(T &out) {
+            if (!advance()) {
+                if (end_ == TokenResult::Error::END) {
+                    error_ = ParseErrorCode::EMPTY_INPUT;
+                }
+                return false;
+            }
+            if (!read(out)) {
+                return false;
+            }
+            if (advance()) {
+                return fail(ParseErrorCode::TRAILING_CONTENT);
+            }
+            if (end_ != TokenResult::Error::END) {
+                return false;
+            }
+            error_ = ParseErrorCode::NONE;
+            return true;
+        }
+
+        ParseError error() const {
+            ParseError error;
+            error.code = error_;
+            LineCounter lines;
+            lines.advance(input_.substr(0, error_at_ - input_.data()));
+            lines.locate(&error);
+            return error;
+        }
+    };
+
+    template <typename T> void write_value(std::string *out, const T &value);
+
+    template <typename T, std::size_t... I>
+    void write_object(std::string *out, const T &value,
+                      std::index_sequence<I...>) {
+        out->push_back('{');
+        (
+            [&] {
+                const auto &field = std::get<I>(Record<T>::fields);
+                if constexpr (I != 0) {
+                    out->push_back(',');
+                }
+                out->push_back('"');
+                out->append(field.name);
+                out->append("\":");
+                write_value(out, value.*field.member);
+            }(),
+            ...);
+        out->push_back('}');
+    }
+
+    template <typename T> void write_value(std::string *out, const T &value) {
+        if constexpr (std::is_same_v<T, bool>) {
+            out->append(value ? "true" : "false");
+        } else if constexpr (std::is_arithmetic_v<T>) {
+            if constexpr (std::is_floating_point_v<T>) {
+                // As in Writer.
+                if (!std::isfinite(value)) {
+                    out->append("null");
+                    return;
+                }
+            }
+            char digits[32];
+            std::to_chars_result result =
+                std::to_chars(digits, digits + sizeof(digits), value);
+            out->append(digits, result.ptr);
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            write_string(out, value);
+        } else if constexpr (IsOptional<T>::value) {
+            if (value) {
+                write_value(out, *value);
+            } else {
+                out->append("null");
+            }
+        } else if constexpr (IsVector<T>::value) {
+            out->push_back('[');
+            bool first = true;
+            for (const auto &element : value) {
+                if (!first) {
+                    out->push_back(',');
+                }
+                first = false;
+                write_value(out, element);
+            }
+            out->push_back(']');
+        } else {
+            static_assert(RecordType<T>,
+                          "serialize() needs a json::Record for T");
+            // Checks the field names.
+            (void)RecordKeys<T>::table;
+            write_object(out, value,
+                         std::make_index_sequence<RecordKeys<T>::N>());
+        }
+    }
+} // namespace json::detail
+
+namespace json {
+    /// Parses `input', which must hold exactly one value, into `out'
+    /// without building a tree.  Keys are matched against the record's
+    /// fields through a perfect hash computed at compile time, and values
+    /// are converted straight into the members.  Members whose keys do not
+    /// appear keep their values, and unknown keys are skipped after their
+    /// values have been checked.  A null leaves an std::optional empty;
+    /// any other mismatch between a value and its member's type is an
+    /// error, as is an integer that does not fit.  Returns false on
+    /// failure, with the reason in `*error' if it is given; `out' may
+    /// have been partly assigned by then.  Unlike parse(), this recurses
+    /// once per level of the target types, so for recursive types
+    /// max_depth also bounds the stack it takes; skipped values are
+    /// checked without recursion.
+    template <typename T>
+    bool parse_into(std::string_view input, T &out, int max_depth = 64,
+                    ParseError *error = nullptr) {
+        detail::BindReader reader(input, max_depth);
+        if (reader.read_document(out)) {
+            return true;
+        }
+        if (error != nullptr) {
+            *error = reader.error();
+        }
+        return false;
+    }
+
+    /// Appends `value' to `*out' as compact JSON in field order.  Empty
+    /// std::optionals are written as null, and numbers as by Writer.
+    template <typename T> void serialize(const T &value, std::string *out) {
+        detail::write_value(out, value);
+    }
+
+    template <typename T> std::string serialize(const T &value) {
+        std::string out;
+        serialize(value, &out);
+        return out;
+    }
+} // namespace json
+
+#endif
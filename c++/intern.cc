@@ -0,0 +1,32 @@
+#include "intern.h"
+
+namespace json {
+    std::string_view KeyInterner::insert(std::size_t index,
+                                         std::string_view key,
+                                         std::size_t hash) {
+        // The arena hands out no memory for an empty key, but a free slot
+        // is told by its null pointer.
+        static const char EMPTY[] = "";
+        std::string_view stored =
+            key.empty() ? std::string_view(EMPTY, 0) : arena_.copy(key);
+        slots_[index] = {stored.data(), stored.size(), hash};
+        ++size_;
+
+        if (2 * size_ > slots_.size()) {
+            std::vector<Slot> old(2 * slots_.size());
+            old.swap(slots_);
+            std::size_t mask = slots_.size() - 1;
+            for (const Slot &slot : old) {
+                if (slot.data == nullptr) {
+                    continue;
+                }
+                std::size_t i = slot.hash & mask;
+                while (slots_[i].data != nullptr) {
+                    i = (i + 1) & mask;
+                }
+                slots_[i] = slot;
+            }
+        }
+        return stored;
+    }
+} // namespace json
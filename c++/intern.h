@@ -0,0 +1,121 @@
+/* -*- mode: c++ -*- */
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include "arena.h"
+
+namespace json {
+    /// Stores each distinct key once.  intern() returns the same view, down
+    /// to the pointer, for equal keys, so documents parsed with a
+    /// KeyInterner share the text of their keys, and two interned keys are
+    /// equal exactly if their data pointers are (JSON_Object lookups check
+    /// the pointer before the bytes).  One KeyInterner may serve many
+    /// documents, e.g. the records of a stream, but only one parse at a
+    /// time.  It never forgets a key, so it suits the bounded key sets of
+    /// records, not keys that are themselves data.
+    class KeyInterner {
+        struct Slot {
+            // nullptr marks a free slot.
+            const char *data = nullptr;
+            std::size_t size = 0;
+            std::size_t hash = 0;
+        };
+
+        static constexpr std::size_t INITIAL_SLOTS = 64;
+
+        Arena arena_;
+        // Open addressing at a load factor of at most 1/2.
+        std::vector<Slot> slots_;
+        std::size_t size_ = 0;
+
+        static std::uint64_t load(const char *p, std::size_t size) {
+            std::uint64_t word = 0;
+            std::memcpy(&word, p, size);
+            return word;
+        }
+
+        /// Keys are short, so they are read a word at a time, with
+        /// overlapping loads instead of a loop over the tail, and mixed by
+        /// multiplication rather than hashed with std::hash.
+        static std::size_t hash(std::string_view key) {
+            constexpr std::uint64_t K = 0x9e3779b97f4a7c15;
+            const char *p = key.data();
+            std::size_t n = key.size();
+            std::uint64_t h = n * K;
+            if (n >= 8) {
+                for (; n > 8; p += 8, n -= 8) {
+                    h = (h ^ load(p, 8)) * K;
+                    h ^= h >> 32;
+                }
+                h ^= load(p + n - 8, 8);
+            } else if (n >= 4) {
+                h ^= load(p, 4) << 32 | load(p + n - 4, 4);
+            } else if (n != 0) {
+                h ^= static_cast<unsigned char>(p[0]) << 16 |
+                     static_cast<unsigned char>(p[n / 2]) << 8 |
+                     static_cast<unsigned char>(p[n - 1]);
+            }
+            h *= K;
+            return static_cast<std::size_t>(h ^ (h >> 32));
+        }
+
+        std::string_view insert(std::size_t index, std::string_view key,
+                                std::size_t hash);
+
+        std::size_t locate(std::string_view key, std::size_t hash) const {
+            std::size_t mask = slots_.size() - 1;
+            std::size_t index = hash & mask;
+            for (;;) {
+                const Slot &slot = slots_[index];
+                if (slot.data == nullptr ||
+                    (slot.hash == hash &&
+                     std::string_view(slot.data, slot.size) == key)) {
+                    return index;
+                }
+                index = (index + 1) & mask;
+            }
+        }
+
+    public:
+        KeyInterner() : slots_(INITIAL_SLOTS) {}
+
+        KeyInterner(const KeyInterner &) = delete;
+        KeyInterner &operator=(const KeyInterner &) = delete;
+
+        /// The stored copy of `key', made on first sight.  It lives as long
+        /// as the KeyInterner.
+        std::string_view intern(std::string_view key) {
+            std::size_t h = hash(key);
+            std::size_t index = locate(key, h);
+            const Slot &slot = slots_[index];
+            if (slot.data == nullptr) {
+                return insert(index, key, h);
+            }
+            return {slot.data, slot.size};
+        }
+
+        /// The stored copy of `key' if it has been interned, else a view
+        /// with a null data pointer.  Looking a key up once and passing the
+        /// result to JSON_Object::get() saves comparing its bytes.
+        std::string_view find(std::string_view key) const {
+            const Slot &slot = slots_[locate(key, hash(key))];
+            return {slot.data, slot.size};
+        }
+
+        /// Number of distinct keys.
+        std::size_t size() const { return size_; }
+
+        /// Bytes taken from the allocator for the keys and the table.
+        std::size_t bytes_reserved() const {
+            return arena_.bytes_reserved() + slots_.capacity() * sizeof(Slot);
+        }
+    };
+} // namespace json
+
+#endif
@@ -0,0 +1,20 @@
+/* -*- mode: c++ -*- */
+#ifndef NUMBER_H
+#define NUMBER_H
+
+#include <cstdint>
+
+namespace json::detail {
+    /// Number of decimal digits that always fit in a std::uint64_t.
+    constexpr int MAX_EXACT_DIGITS = 19;
+
+    /// Converts `mantissa' * 10^`exponent' to the nearest double using
+    /// Clinger's fast path or the Eisel-Lemire algorithm.  `mantissa' must
+    /// hold every significant digit of the number.  Returns false when the
+    /// result cannot be decided cheaply; the caller then has to fall back
+    /// to a slower exact conversion.
+    bool decimal_to_double(bool negative, std::uint64_t mantissa,
+                           std::int64_t exponent, double *result);
+} // namespace json::detail
+
+#endif
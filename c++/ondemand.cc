@@ -0,0 +1,376 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <limits>
+
+#include "ondemand.h"
+#include "sax.h"
+#include "scan.h"
+
+namespace json {
+    namespace {
+        /// Decodes the reference token after the '/' at `*pos' into `token'
+        /// and moves `*pos' to the next '/' or the end of `pointer'.
+        /// Returns false on a '~' that is not followed by '0' or '1'.
+        bool next_reference(std::string_view pointer, std::size_t *pos,
+                            std::string *token) {
+            token->clear();
+            std::size_t i = *pos + 1;
+            for (; i < pointer.size() && pointer[i] != '/'; ++i) {
+                if (pointer[i] != '~') {
+                    token->push_back(pointer[i]);
+                    continue;
+                }
+                if (i + 1 == pointer.size()) {
+                    return false;
+                } else if (pointer[i + 1] == '0') {
+                    token->push_back('~');
+                } else if (pointer[i + 1] == '1') {
+                    token->push_back('/');
+                } else {
+                    return false;
+                }
+                ++i;
+            }
+            *pos = i;
+            return true;
+        }
+
+        /// Array indexes are "0" or digits without a leading zero.  "-",
+        /// which refers past the last element, never names a value.
+        bool parse_index(const std::string &token, std::size_t *index) {
+            if (token.empty() || (token.size() > 1 && token[0] == '0')) {
+                return false;
+            }
+            const char *end = token.data() + token.size();
+            auto [ptr, ec] = std::from_chars(token.data(), end, *index);
+            return ec == std::errc() && ptr == end;
+        }
+
+        bool is_value_start(char c) {
+            return c != ',' && c != ':' && c != ']' && c != '}';
+        }
+
+        /// Kinds of structurals, for checking the structure of a document
+        /// as it is indexed.
+        enum Token : std::uint8_t {
+            OPEN_OBJECT,
+            OPEN_ARRAY,
+            CLOSE_OBJECT,
+            CLOSE_ARRAY,
+            COMMA,
+            COLON,
+            STRING,
+            SCALAR, // a number or literal, valid or not
+            TOKENS,
+        };
+
+        /// What may come next, as in detail::Grammar, but with the kind of
+        /// the innermost container folded in, so that one table lookup per
+        /// structural does the whole check, brackets matching included.
+        enum State : std::uint8_t {
+            ROOT,           // the root value
+            ELEMENT,        // a value after ','
+            FIRST_ELEMENT,  // a value or ']' after '['
+            FIRST_MEMBER,   // a key or '}' after '{'
+            KEY,            // a key after ','
+            AFTER_KEY,      // ':'
+            MEMBER,         // a value after ':'
+            AFTER_ROOT,     // the end of the input
+            AFTER_ELEMENT,  // ',' or ']'
+            AFTER_MEMBER,   // ',' or '}'
+            CLOSED,         // a container has closed; see index()
+            INVALID,
+            STATES = INVALID,
+        };
+
+        constexpr std::array<Token, 256> make_token_kinds() {
+            std::array<Token, 256> kinds{};
+            kinds.fill(SCALAR);
+            kinds['{'] = OPEN_OBJECT;
+            kinds['['] = OPEN_ARRAY;
+            kinds['}'] = CLOSE_OBJECT;
+            kinds[']'] = CLOSE_ARRAY;
+            kinds[','] = COMMA;
+            kinds[':'] = COLON;
+            kinds['"'] = STRING;
+            return kinds;
+        }
+
+        constexpr std::array<Token, 256> TOKEN_KINDS = make_token_kinds();
+
+        constexpr std::array<std::array<State, TOKENS>, STATES>
+        make_transitions() {
+            std::array<std::array<State, TOKENS>, STATES> next{};
+            for (auto &row : next) {
+                row.fill(INVALID);
+            }
+            // A value; opening brackets lead to the first element or
+            // member, and the state after the container is the one after
+            // a scalar in its place.
+            const State after_value[][2] = {{ROOT, AFTER_ROOT},
+                                            {ELEMENT, AFTER_ELEMENT},
+                                            {FIRST_ELEMENT, AFTER_ELEMENT},
+                                            {MEMBER, AFTER_MEMBER}};
+            for (const auto &[state, after] : after_value) {
+                next[state][OPEN_OBJECT] = FIRST_MEMBER;
+                next[state][OPEN_ARRAY] = FIRST_ELEMENT;
+                next[state][STRING] = after;
+                next[state][SCALAR] = after;
+            }
+            next[FIRST_ELEMENT][CLOSE_ARRAY] = CLOSED;
+            next[FIRST_MEMBER][CLOSE_OBJECT] = CLOSED;
+            next[FIRST_MEMBER][STRING] = AFTER_KEY;
+            next[KEY][STRING] = AFTER_KEY;
+            next[AFTER_KEY][COLON] = MEMBER;
+            next[AFTER_ELEMENT][COMMA] = ELEMENT;
+            next[AFTER_ELEMENT][CLOSE_ARRAY] = CLOSED;
+            next[AFTER_MEMBER][COMMA] = KEY;
+            next[AFTER_MEMBER][CLOSE_OBJECT] = CLOSED;
+            return next;
+        }
+
+        constexpr std::array<std::array<State, TOKENS>, STATES> TRANSITIONS =
+            make_transitions();
+    } // namespace
+
+    OnDemandDocument::OnDemandDocument(std::string_view input, int max_depth)
+        : input_(input), max_depth_(std::max(max_depth, 0)) {
+        index();
+        if (!ok_) {
+            structurals_.clear();
+        }
+    }
+
+    void OnDemandDocument::fail(ParseErrorCode code, std::size_t offset) {
+        error_.code = code;
+        detail::LineCounter lines;
+        lines.advance(input_.substr(0, offset));
+        lines.locate(&error_);
+    }
+
+    void OnDemandDocument::index() {
+        if (input_.size() > std::numeric_limits<std::uint32_t>::max()) {
+            return fail(ParseErrorCode::TOO_LARGE, 0);
+        }
+
+        const detail::ClassifyFn classify = detail::select_kernels().classify;
+        detail::StructuralScanner scanner;
+        const char *data = input_.data();
+        struct Open {
+            std::uint32_t index;
+            // The state once the container has closed.
+            State after;
+        };
+        // The brackets that are still open.
+        std::vector<Open> open;
+        State state = ROOT;
+        for (std::size_t block = 0; block < input_.size();
+             block += detail::SCAN_BLOCK_SIZE) {
+            detail::BlockMasks masks;
+            if (input_.size() - block >= detail::SCAN_BLOCK_SIZE) {
+                classify(data + block, &masks);
+            } else {
+                char tail[detail::SCAN_BLOCK_SIZE];
+                std::memset(tail, ' ', sizeof(tail));
+                std::memcpy(tail, data + block, input_.size() - block);
+                classify(tail, &masks);
+            }
+
+            for (std::uint64_t bits = scanner.next(masks); bits != 0;
+                 bits &= bits - 1) {
+                auto offset =
+                    static_cast<std::uint32_t>(block + std::countr_zero(bits));
+                auto here = static_cast<std::uint32_t>(structurals_.size());
+                structurals_.push_back({offset, 0});
+
+                Token token = TOKEN_KINDS[static_cast<unsigned char>(
+                    data[offset])];
+                State next = TRANSITIONS[state][token];
+                if (next == INVALID) {
+                    return fail(state == AFTER_ROOT
+                                    ? ParseErrorCode::TRAILING_CONTENT
+                                    : ParseErrorCode::UNEXPECTED_TOKEN,
+                                offset);
+                } else if (token <= OPEN_ARRAY) {
+                    // See parse() for the depth limit.
+                    if (max_depth_ <= static_cast<int>(open.size()) + 1) {
+                        return fail(ParseErrorCode::TOO_DEEP, offset);
+                    }
+                    open.push_back({here, TRANSITIONS[state][SCALAR]});
+                } else if (next == CLOSED) {
+                    structurals_[open.back().index].close = here;
+                    next = open.back().after;
+                    open.pop_back();
+                }
+                state = next;
+            }
+        }
+
+        ok_ = !scanner.in_string() && state == AFTER_ROOT;
+        if (!ok_) {
+            fail(state == ROOT ? ParseErrorCode::EMPTY_INPUT
+                               : ParseErrorCode::UNEXPECTED_END,
+                 input_.size());
+        }
+    }
+
+    /// The index of the structural after the value that starts at
+    /// `index'.
+    std::size_t OnDemandDocument::skip(std::size_t index) const {
+        char c = input_[structurals_[index].offset];
+        if (c == '{' || c == '[') {
+            return structurals_[index].close + 1;
+        }
+        return index + 1;
+    }
+
+    bool OnDemandDocument::key_equals(std::size_t index,
+                                      std::string_view key) const {
+        const char *begin = input_.data() + structurals_[index].offset;
+        // The key ends with the last quote before the colon that follows.
+        const char *limit = input_.data() + structurals_[index + 1].offset;
+        const char *end = limit;
+        while (end - 1 > begin && end[-1] != '"') {
+            --end;
+        }
+        if (end - 1 <= begin) {
+            return false;
+        }
+
+        std::string_view raw(begin + 1, end - 1 - (begin + 1));
+        if (raw.find('\\') == std::string_view::npos) {
+            return raw == key;
+        }
+        detail::Lexer lexer(std::string_view(begin, limit - begin));
+        detail::TokenResult tk = lexer.next();
+        return tk && (*tk).get_type() == detail::TokenType::STRING &&
+               (*tk).get_token() == key;
+    }
+
+    bool OnDemandDocument::locate(std::string_view pointer, std::size_t *index,
+                                  int *depth) const {
+        if (!ok_ || (!pointer.empty() && pointer[0] != '/')) {
+            return false;
+        }
+
+        auto at = [this](std::size_t i) {
+            return input_[structurals_[i].offset];
+        };
+
+        std::size_t i = 0;
+        std::string reference;
+        *depth = 0;
+        for (std::size_t pos = 0; pos < pointer.size();) {
+            if (!next_reference(pointer, &pos, &reference)) {
+                return false;
+            }
+            ++*depth;
+
+            std::size_t close = structurals_[i].close;
+            if (at(i) == '{') {
+                std::size_t found = 0;
+                std::size_t j = i + 1;
+                while (j != close) {
+                    if (j + 2 >= close || at(j) != '"' || at(j + 1) != ':' ||
+                        !is_value_start(at(j + 2))) {
+                        return false;
+                    }
+                    if (key_equals(j, reference)) {
+                        found = j + 2;
+                    }
+                    j = skip(j + 2);
+                    if (j != close && (at(j) != ',' || ++j == close)) {
+                        return false;
+                    }
+                }
+                if (found == 0) {
+                    return false;
+                }
+                i = found;
+            } else if (at(i) == '[') {
+                std::size_t wanted;
+                if (!parse_index(reference, &wanted)) {
+                    return false;
+                }
+                std::size_t j = i + 1;
+                for (std::size_t n = 0;; ++n) {
+                    if (j == close || !is_value_start(at(j))) {
+                        return false;
+                    }
+                    if (n == wanted) {
+                        break;
+                    }
+                    j = skip(j);
+                    // Anything but a comma means the index is out of range
+                    // or the array is malformed.
+                    if (j == close || at(j) != ',') {
+                        return false;
+                    }
+                    ++j;
+                }
+                i = j;
+            } else {
+                return false;
+            }
+        }
+        *index = i;
+        return true;
+    }
+
+    std::optional<std::string_view>
+    OnDemandDocument::raw_at(std::string_view pointer) const {
+        std::size_t index;
+        int depth;
+        if (!locate(pointer, &index, &depth)) {
+            return std::nullopt;
+        }
+
+        std::size_t offset = structurals_[index].offset;
+        char c = input_[offset];
+        if (!is_value_start(c)) {
+            return std::nullopt;
+        } else if (c == '{' || c == '[') {
+            std::size_t close = structurals_[structurals_[index].close].offset;
+            return input_.substr(offset, close + 1 - offset);
+        }
+
+        detail::Lexer lexer(input_.substr(offset));
+        detail::TokenResult tk = lexer.next();
+        if (!tk) {
+            return std::nullopt;
+        }
+        const char *begin = input_.data() + offset;
+        return std::string_view(begin, lexer.position() - begin);
+    }
+
+    JSON_File OnDemandDocument::at(std::string_view pointer) const {
+        std::size_t index;
+        int depth;
+        JSON_File result;
+        if (!locate(pointer, &index, &depth)) {
+            result.set_error(ok_ ? ParseError{ParseErrorCode::NOT_FOUND}
+                                 : error_);
+            return result;
+        }
+
+        TreeBuilder builder(result.get_arena());
+        int max_depth = std::max(max_depth_ - depth, 0);
+        detail::Grammar<TreeBuilder> grammar(builder, max_depth);
+        detail::Lexer lexer(input_.substr(structurals_[index].offset));
+        do {
+            detail::TokenResult tk = lexer.next();
+            if (!tk || !grammar.next(*tk)) {
+                // The lexer's positions are in input_, so the error is
+                // located in the whole input.
+                result.set_error(detail::describe_failure(
+                    input_, lexer, grammar, tk ? nullptr : &tk));
+                return result;
+            }
+        } while (!grammar.done());
+        result.set_root(builder.get_root());
+        return result;
+    }
+} // namespace json
@@ -0,0 +1,78 @@
+/* -*- mode: c++ -*- */
+#ifndef ONDEMAND_H
+#define ONDEMAND_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "parse.h"
+
+namespace json {
+    /// Extracts single values from a document without building a tree for
+    /// the rest of it.  The constructor runs the SIMD structural scanner
+    /// over the input once, recording where every token starts and which
+    /// brackets match.  A lookup then follows an RFC 6901 JSON Pointer such
+    /// as "/user/id" through that index, stepping over every value next to
+    /// the path in constant time, and only the value the pointer names is
+    /// lexed and materialized.
+    ///
+    /// Validation is correspondingly partial: the structure of the whole
+    /// document is checked while it is indexed, with matching brackets,
+    /// commas and colons in their places, nesting depth and a single root
+    /// value, but strings, numbers and literals are only validated where
+    /// they are read.  A document that parse() rejects can therefore
+    /// still yield values here.  As in a JSON_Object, the last of
+    /// several members with the same name is the one that is found.
+    class OnDemandDocument {
+        struct Structural {
+            std::uint32_t offset;
+            // For an opening bracket, the index of the matching closing
+            // one.
+            std::uint32_t close;
+        };
+
+        std::string_view input_;
+        int max_depth_;
+        bool ok_ = false;
+        ParseError error_;
+        std::vector<Structural> structurals_;
+
+        void index();
+        void fail(ParseErrorCode code, std::size_t offset);
+        std::size_t skip(std::size_t index) const;
+        bool key_equals(std::size_t index, std::string_view key) const;
+
+        /// Finds the index of the structural that starts the value
+        /// `pointer' refers to and the number of containers around it.
+        bool locate(std::string_view pointer, std::size_t *index,
+                    int *depth) const;
+
+    public:
+        /// `input' must outlive the OnDemandDocument.  max_depth has the
+        /// meaning documented for parse().
+        explicit OnDemandDocument(std::string_view input, int max_depth = 64);
+
+        /// False if the structure of the document is invalid, in which
+        /// case every lookup fails.
+        bool ok() const { return ok_; }
+
+        /// Why and where indexing failed, if ok() is false.
+        const ParseError &get_error() const { return error_; }
+
+        /// The source text of the value at `pointer', or nullopt if there
+        /// is none or it is malformed.  Containers are returned without
+        /// validating their contents.
+        std::optional<std::string_view> raw_at(std::string_view pointer) const;
+
+        /// The value at `pointer' as a tree of its own.  ok() is false if
+        /// there is no such value, with NOT_FOUND and no position, or if
+        /// it is malformed, with the error's position in the whole input.
+        /// If the document is invalid, the error is get_error().
+        JSON_File at(std::string_view pointer) const;
+    };
+} // namespace json
+
+#endif
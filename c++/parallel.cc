@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "parallel.h"
+#include "sax.h"
+#include "scan.h"
+
+namespace json {
+    namespace {
+        /// Pre-scan chunks; a multiple of SCAN_BLOCK_SIZE, so that only
+        /// the last chunk has a partial block.
+        constexpr std::size_t SCAN_CHUNK_SIZE = 1 << 20;
+
+        /// Elements are parsed in runs of about this many bytes.
+        constexpr std::size_t TASK_SIZE = 64 * 1024;
+
+        bool is_space(char c) {
+            return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+        }
+
+        /// True if `pos' follows an odd-length run of backslashes.
+        bool escaped_at(std::string_view input, std::size_t pos) {
+            std::size_t run = 0;
+            while (run < pos && input[pos - run - 1] == '\\') {
+                ++run;
+            }
+            return run % 2 == 1;
+        }
+
+        /// Calls f(offset, structural_ops) for every block of
+        /// [begin, end), where structural_ops has the bits of the
+        /// operators outside strings.
+        template <typename F>
+        void scan_ops(std::string_view input, std::size_t begin,
+                      std::size_t end, detail::StructuralScanner &scanner,
+                      F f) {
+            const detail::ClassifyFn classify =
+                detail::select_kernels().classify;
+            for (std::size_t block = begin; block < end;
+                 block += detail::SCAN_BLOCK_SIZE) {
+                detail::BlockMasks masks;
+                if (input.size() - block >= detail::SCAN_BLOCK_SIZE) {
+                    classify(input.data() + block, &masks);
+                } else {
+                    char tail[detail::SCAN_BLOCK_SIZE];
+                    std::memset(tail, ' ', sizeof(tail));
+                    std::memcpy(tail, input.data() + block,
+                                input.size() - block);
+                    classify(tail, &masks);
+                }
+                f(block, scanner.next(masks) & masks.op);
+            }
+        }
+
+        /// Adds the brackets among `ops' to `*depth', and calls
+        /// on_comma(offset) for each comma found at depth 1.
+        template <typename F>
+        void track_depth(const char *data, std::size_t block,
+                         std::uint64_t ops, std::int64_t *depth,
+                         F on_comma) {
+            for (; ops != 0; ops &= ops - 1) {
+                std::size_t offset = block + std::countr_zero(ops);
+                char c = data[offset];
+                if (c == '[' || c == '{') {
+                    ++*depth;
+                } else if (c == ']' || c == '}') {
+                    --*depth;
+                } else if (c == ',' && *depth == 1) {
+                    on_comma(offset);
+                }
+            }
+        }
+
+        struct Chunk {
+            std::size_t begin;
+            std::size_t end;
+            bool escaped;
+            // Whether the chunk has an odd number of unescaped quotes,
+            // and its change in depth for each state it may start in.
+            bool odd_quotes;
+            std::int64_t delta[2];
+            // Where it starts, once the chunks before it are known.
+            bool in_string;
+            std::int64_t depth;
+            std::vector<std::size_t> commas;
+        };
+
+        /// Finds the separators of the root array's elements: the offsets
+        /// of its brackets and of the commas between them.  Returns false
+        /// if the root is not an array, or the commas show that the
+        /// document is malformed.
+        bool find_separators(std::string_view input, unsigned threads,
+                             std::vector<std::size_t> *separators) {
+            std::size_t first = 0;
+            while (first < input.size() && is_space(input[first])) {
+                ++first;
+            }
+            std::size_t last = input.size();
+            while (last > first && is_space(input[last - 1])) {
+                --last;
+            }
+            if (last - first < 2 || input[first] != '[' ||
+                input[last - 1] != ']') {
+                return false;
+            }
+
+            std::vector<Chunk> chunks;
+            for (std::size_t begin = 0; begin < input.size();
+                 begin += SCAN_CHUNK_SIZE) {
+                Chunk &chunk = chunks.emplace_back();
+                chunk.begin = begin;
+                chunk.end = std::min(begin + SCAN_CHUNK_SIZE, input.size());
+                chunk.escaped = escaped_at(input, begin);
+            }
+
+            // Whether a chunk starts inside a string depends on every
+            // quote before it, so each chunk is scanned both ways first.
+            detail::run_parallel(chunks.size(), threads, [&](std::size_t i) {
+                Chunk &chunk = chunks[i];
+                for (int in_string = 0; in_string < 2; ++in_string) {
+                    detail::StructuralScanner scanner(in_string,
+                                                      chunk.escaped);
+                    std::int64_t depth = 0;
+                    scan_ops(input, chunk.begin, chunk.end, scanner,
+                             [&](std::size_t block, std::uint64_t ops) {
+                                 track_depth(input.data(), block, ops, &depth,
+                                             [](std::size_t) {});
+                             });
+                    chunk.delta[in_string] = depth;
+                    if (!in_string) {
+                        chunk.odd_quotes = scanner.in_string();
+                    }
+                }
+            });
+
+            bool in_string = false;
+            std::int64_t depth = 0;
+            for (Chunk &chunk : chunks) {
+                chunk.in_string = in_string;
+                chunk.depth = depth;
+                depth += chunk.delta[in_string];
+                in_string ^= chunk.odd_quotes;
+            }
+
+            detail::run_parallel(chunks.size(), threads, [&](std::size_t i) {
+                Chunk &chunk = chunks[i];
+                detail::StructuralScanner scanner(chunk.in_string,
+                                                  chunk.escaped);
+                std::int64_t depth = chunk.depth;
+                scan_ops(input, chunk.begin, chunk.end, scanner,
+                         [&](std::size_t block, std::uint64_t ops) {
+                             track_depth(input.data(), block, ops, &depth,
+                                         [&](std::size_t offset) {
+                                             chunk.commas.push_back(offset);
+                                         });
+                         });
+            });
+
+            separators->push_back(first);
+            for (const Chunk &chunk : chunks) {
+                for (std::size_t comma : chunk.commas) {
+                    // Only possible in a malformed document.
+                    if (comma < first || comma >= last - 1) {
+                        return false;
+                    }
+                    separators->push_back(comma);
+                }
+            }
+            separators->push_back(last - 1);
+            return true;
+        }
+
+        /// Parses the element between separators[i] and separators[i + 1]
+        /// with `grammar', which has been reset.
+        bool parse_element(std::string_view input,
+                           const std::vector<std::size_t> &separators,
+                           std::size_t i,
+                           detail::Grammar<TreeBuilder> &grammar) {
+            std::size_t begin = separators[i] + 1;
+            std::size_t end = separators[i + 1];
+            detail::Lexer lexer(input.substr(begin, end - begin));
+            for (;;) {
+                detail::TokenResult tk = lexer.next();
+                if (!tk) {
+                    return tk.get_error() == detail::TokenResult::Error::END &&
+                           grammar.done();
+                }
+                if (!grammar.next(*tk)) {
+                    return false;
+                }
+            }
+        }
+    } // namespace
+
+    namespace detail {
+        void run_parallel(std::size_t count, unsigned threads,
+                          const std::function<void(std::size_t)> &task) {
+            if (threads == 0) {
+                threads = std::max(1u, std::thread::hardware_concurrency());
+            }
+            threads =
+                static_cast<unsigned>(std::min<std::size_t>(threads, count));
+
+            std::atomic<std::size_t> next{0};
+            auto work = [&] {
+                for (std::size_t i; (i = next++) < count;) {
+                    task(i);
+                }
+            };
+            std::vector<std::thread> workers;
+            for (unsigned i = 1; i < threads; ++i) {
+                workers.emplace_back(work);
+            }
+            work();
+            for (std::thread &worker : workers) {
+                worker.join();
+            }
+        }
+    } // namespace detail
+
+    JSON_File parse_parallel(std::string_view input, unsigned threads,
+                             int max_depth) {
+        std::vector<std::size_t> separators;
+        // See Grammar::open() for why the root array needs a depth of 2.
+        if (input.size() < PARALLEL_MIN_SIZE || max_depth <= 1 ||
+            !find_separators(input, threads, &separators)) {
+            return parse(input, max_depth);
+        }
+
+        // Runs of neighbouring elements, by the index of their first one.
+        std::vector<std::size_t> tasks;
+        for (std::size_t i = 0; i + 1 < separators.size(); ++i) {
+            if (tasks.empty() ||
+                separators[i] - separators[tasks.back()] >= TASK_SIZE) {
+                tasks.push_back(i);
+            }
+        }
+        std::size_t size = separators.size() - 1;
+        tasks.push_back(size);
+
+        JSON_File result;
+        auto **elements = static_cast<JSON_Primitive **>(
+            result.get_arena().allocate_raw(sizeof(JSON_Primitive *) * size,
+                                            alignof(JSON_Primitive *)));
+        std::vector<Arena> arenas(tasks.size() - 1);
+        std::atomic<bool> failed{false};
+        detail::run_parallel(arenas.size(), threads, [&](std::size_t t) {
+            TreeBuilder builder;
+            // The elements are one level below the root.
+            detail::Grammar<TreeBuilder> grammar(builder, max_depth - 1);
+            for (std::size_t i = tasks[t]; i < tasks[t + 1]; ++i) {
+                if (failed.load(std::memory_order_relaxed)) {
+                    return;
+                }
+                builder.reset(arenas[t]);
+                grammar.reset();
+                if (!parse_element(input, separators, i, grammar)) {
+                    failed.store(true, std::memory_order_relaxed);
+                    return;
+                }
+                elements[i] = builder.get_root();
+            }
+        });
+        if (failed) {
+            return parse(input, max_depth);
+        }
+
+        for (Arena &arena : arenas) {
+            result.get_arena().adopt(std::move(arena));
+        }
+        result.set_root(result.get_arena().make<JSON_Array>(elements, size));
+        return result;
+    }
+} // namespace json
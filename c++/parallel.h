@@ -0,0 +1,38 @@
+/* -*- mode: c++ -*- */
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <cstddef>
+#include <functional>
+#include <string_view>
+
+#include "parse.h"
+
+namespace json {
+    /// Parses a document whose root is an array on `threads' threads, or
+    /// one per hardware thread if 0.  A structural pre-scan, itself split
+    /// over the threads, finds the commas that separate the root's
+    /// elements; runs of elements are then parsed concurrently and the
+    /// arenas they were built in are adopted by the result.
+    ///
+    /// The result is the one parse() gives: strings are copied, max_depth
+    /// counts the root array, and if any element fails the whole input is
+    /// parsed again sequentially, so a malformed document is reported
+    /// exactly as parse() reports it.  Inputs under PARALLEL_MIN_SIZE and
+    /// those whose root is not an array go straight to parse().
+    JSON_File parse_parallel(std::string_view input, unsigned threads = 0,
+                             int max_depth = 64);
+
+    constexpr std::size_t PARALLEL_MIN_SIZE = 1 << 20;
+
+    namespace detail {
+        /// Calls task(i) for every i below `count' on up to `threads'
+        /// threads, one per hardware thread if 0, counting the calling
+        /// one.  Each thread takes the next index from a shared counter,
+        /// so tasks should be small enough to even out.
+        void run_parallel(std::size_t count, unsigned threads,
+                          const std::function<void(std::size_t)> &task);
+    } // namespace detail
+} // namespace json
+
+#endif
@@ -1,681 +1,471 @@
-#include <optional>
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "binary.h"
 #include "parse.h"
+#include "sax.h"
+#include "tape.h"
 
 namespace json {
     namespace {
-        enum class TokenType {
-            ARRAY_OPEN,
-            ARRAY_CLOSE,
-            OBJ_OPEN,
-            OBJ_CLOSE,
-            COLON,
-            COMMA,
-            STRING,
-            NUMBER,
-            TRUE,
-            FALSE,
-            NULL_OBJ,
-        };
+        /// Appends a document to a Tape's word and string buffers; see
+        /// tape.h for the layout.
+        class TapeBuilder {
+            struct Frame {
+                std::size_t index;
+                std::uint64_t count;
+            };
 
-        class Token {
-            TokenType type_;
-            std::string token_;
-
-            std::string parse_4hex_codepoint(const std::string_view &hex) {
-                std::uint32_t codepoint = 0;
-                for (char c : hex) {
-                    int val = 0;
-                    if ('0' <= c && c <= '9') {
-                        val = c - '0';
-                    } else if ('a' <= c && c <= 'f') {
-                        val = c - 131;
-                    } else if ('A' <= c && c <= 'F') {
-                        val = c - 91;
-                    }
-                    codepoint <<= 4;
-                    codepoint |= val;
-                }
+            std::vector<std::uint64_t> &words_;
+            std::string &strings_;
+            std::vector<Frame> frames_;
+            bool too_large_ = false;
 
-                std::string result;
-                if (codepoint > 0x7ff) {
-                    result.push_back(0xe0 | ((codepoint >> 12) & 0x0f));
-                    result.push_back(0x80 | ((codepoint >> 6) & 0x3f));
-                    result.push_back(0x80 | ((codepoint >> 0) & 0x3f));
-
-                } else if (codepoint > 0x7f) {
-                    result.push_back(0xc0 | ((codepoint >> 6) & 0x1f));
-                    result.push_back(0x80 | ((codepoint >> 0) & 0x3f));
-                } else {
-                    result.push_back(codepoint & 0x7f);
-                }
+            /// Largest index past a close word, and longest string, that
+            /// the 32-bit fields of the tape can hold.
+            static constexpr std::uint64_t MAX_FIELD = 0xffffffff;
 
-                return result;
+            void push(TapeTag tag, std::uint64_t payload) {
+                words_.push_back(static_cast<std::uint64_t>(tag) << 56 |
+                                 payload);
             }
 
-            std::string unescape_string(const std::string &str) {
-                std::string result;
-                result.reserve(str.size());
-                for (size_t i = 0; i < str.size(); ++i) {
-                    if (str[i] == '\\') {
-                        if (str[i + 1] == 'u') {
-                            std::string data = parse_4hex_codepoint(
-                                std::string_view(str.data() + i + 2, 4));
-                            result.insert(result.end(), data.begin(),
-                                          data.end());
-                            i += 4;
-                        } else {
-                            switch (str[i + 1]) {
-                            case '"':
-                                result.push_back('"');
-                                break;
-                            case '\\':
-                                result.push_back('\\');
-                                break;
-                            case '/':
-                                result.push_back('/');
-                                break;
-                            case 'b':
-                                result.push_back('\b');
-                                break;
-                            case 'f':
-                                result.push_back('\f');
-                                break;
-                            case 'n':
-                                result.push_back('\n');
-                                break;
-                            case 'r':
-                                result.push_back('r');
-                                break;
-                            case 't':
-                                result.push_back('\t');
-                                break;
-                            }
-                            ++i;
-                        }
-                    }
+            bool add(TapeTag tag, std::uint64_t payload) {
+                if (!frames_.empty()) {
+                    ++frames_.back().count;
                 }
-                return result;
+                push(tag, payload);
+                return true;
             }
 
-        public:
-            Token(TokenType type, std::string token)
-                : type_(type), token_(token) {}
-
-            Token(Token &&tk) {
-                type_ = tk.type_;
-                token_ = std::move(tk.token_);
+            bool add_number(TapeTag tag, std::uint64_t bits) {
+                add(tag, 0);
+                words_.push_back(bits);
+                return true;
             }
 
-            Token(const Token &tk) {
-                type_ = tk.type_;
-                token_ = tk.token_;
-            }
-
-            TokenType get_type() const { return type_; }
-
-            std::string const &get_token() const { return token_; }
-
-            Token &operator=(const Token &tk) {
-                type_ = tk.type_;
-                token_ = tk.token_;
-                return *this;
-            }
-
-            Token &operator=(Token &&tk) {
-                type_ = tk.type_;
-                token_ = std::move(tk.token_);
-                return *this;
+            /// Returns false, leaving the tape as is, if `str' is too
+            /// long.
+            bool add_string(TapeTag tag, std::string_view str) {
+                if (str.size() > MAX_FIELD) {
+                    too_large_ = true;
+                    return false;
+                }
+                std::uint64_t offset = strings_.size();
+                std::uint32_t length = static_cast<std::uint32_t>(str.size());
+                strings_.append(reinterpret_cast<const char *>(&length),
+                                sizeof(length));
+                strings_.append(str);
+                push(tag, offset);
+                return true;
             }
 
-            bool parse_boolean() { return token_[0] == 't'; }
-
-            std::string parse_string() {
-                std::string result =
-                    unescape_string(token_.substr(1, token_.size() - 2));
-                return result;
+            bool open(TapeTag tag) {
+                add(tag, 0);
+                frames_.push_back({words_.size() - 1, 0});
+                return true;
             }
 
-            double parse_number() { return std::stod(token_); }
-        };
+            bool close(TapeTag tag) {
+                Frame frame = frames_.back();
+                frames_.pop_back();
 
-        bool tokenize_string(std::istream &strm, std::string *token) {
-            bool escaped = false;
-            int required_digits = 0;
-            for (;;) {
-                std::uint8_t c = strm.get();
-                if (strm.fail()) {
+                std::uint64_t close_index = words_.size();
+                if (close_index + 1 > MAX_FIELD) {
+                    too_large_ = true;
                     return false;
                 }
-
-                token->push_back(c);
-                if (escaped) {
-                    if (required_digits != 0) {
-                        if (('0' <= c && c <= '9') || ('a' <= c && c <= 'f') ||
-                            ('A' <= c && c <= 'F')) {
-                            --required_digits;
-                            if (required_digits == 0) {
-                                escaped = false;
-                            }
-                        } else {
-                            return false;
-                        }
-                    } else if (c == '"' || c == '\\' || c == '/' || c == 'b' ||
-                               c == 'f' || c == 'n' || c == 'r' || c == 't' ||
-                               c == 'u') {
-                        if (c == 'u') {
-                            required_digits = 4;
-                        } else {
-                            escaped = false;
-                        }
-                    } else {
-                        return false;
-                    }
-                } else {
-                    if (c < 20) {
-                        return false;
-                    } else if (c == '"') {
-                        break;
-                    } else if (c == '\\') {
-                        escaped = true;
-                    }
-                }
+                std::uint64_t count = std::min<std::uint64_t>(
+                    frame.count, TAPE_COUNT_SATURATED);
+                words_[frame.index] |= count << 32 | (close_index + 1);
+                push(tag, frame.index);
+                return true;
             }
-            return true;
-        }
 
-        bool tokenize_number(std::istream &strm, std::string *token) {
-            enum { INTEGER, FRACTION, EXPONENT } state = INTEGER;
+        public:
+            TapeBuilder(std::vector<std::uint64_t> &words, std::string &strings)
+                : words_(words), strings_(strings) {}
 
-            char first_num;
-            if ((*token)[0] == '-') {
-                first_num = strm.get();
-                if (strm.fail()) {
-                    return false;
-                }
+            bool value(std::nullptr_t) { return add(TapeTag::NULL_VALUE, 0); }
 
-                if ('0' <= first_num && first_num <= '9') {
-                    token->push_back(first_num);
-                } else {
-                    return false;
-                }
-            } else {
-                first_num = (*token)[0];
+            bool value(bool b) {
+                return add(b ? TapeTag::TRUE_VALUE : TapeTag::FALSE_VALUE, 0);
             }
 
-            if (first_num == '0') {
-                char c = strm.get();
-                if (strm.fail()) {
-                    return true;
-                }
-
-                if (c == '.') {
-                    token->push_back(c);
-                    state = FRACTION;
-                } else if (c == 'E' || c == 'e') {
-                    token->push_back(c);
-                    state = EXPONENT;
-                } else {
-                    strm.unget();
-                    return true;
-                }
-            } else if (!('1' <= first_num && first_num <= '9')) {
-                return false;
+            bool value(std::int64_t n) {
+                return add_number(TapeTag::INT64, static_cast<std::uint64_t>(n));
             }
 
-            if (state == INTEGER) {
-                for (;;) {
-                    char c = strm.get();
-                    if (strm.fail()) {
-                        return true;
-                    }
-
-                    if ('0' <= c && c <= '9') {
-                        token->push_back(c);
-                    } else if (c == '.') {
-                        token->push_back(c);
-                        state = FRACTION;
-                        break;
-                    } else if (c == 'E' || c == 'e') {
-                        token->push_back(c);
-                        state = EXPONENT;
-                        break;
-                    } else {
-                        strm.unget();
-                        return true;
-                    }
-                }
+            bool value(std::uint64_t n) {
+                return add_number(TapeTag::UINT64, n);
             }
 
-            if (state == FRACTION) {
-                char c = strm.get();
-                if (strm.fail()) {
-                    return false;
-                }
+            bool value(double n) {
+                return add_number(TapeTag::DOUBLE, std::bit_cast<std::uint64_t>(n));
+            }
 
-                if ('0' <= c && c <= '9') {
-                    token->push_back(c);
-                } else {
-                    strm.unget();
-                    return false;
+            bool value(std::string_view str) {
+                if (!frames_.empty()) {
+                    ++frames_.back().count;
                 }
+                return add_string(TapeTag::STRING, str);
+            }
 
-                for (;;) {
-                    char c = strm.get();
-                    if (strm.fail()) {
-                        return true;
-                    }
+            bool start_object() { return open(TapeTag::OBJECT_OPEN); }
 
-                    if ('0' <= c && c <= '9') {
-                        token->push_back(c);
-                    } else if (c == 'E' || c == 'e') {
-                        token->push_back(c);
-                        state = EXPONENT;
-                        break;
-                    } else {
-                        strm.unget();
-                        return true;
-                    }
-                }
+            bool key(std::string_view key) {
+                return add_string(TapeTag::STRING, key);
             }
 
-            if (state == EXPONENT) {
-                char c = strm.get();
-                if (strm.fail()) {
-                    return false;
-                }
+            bool end_object() { return close(TapeTag::OBJECT_CLOSE); }
 
-                if (c == '+' || c == '-') {
-                    token->push_back(c);
-                    c = strm.get();
-                    if (strm.fail()) {
-                        return false;
-                    }
-                }
+            bool start_array() { return open(TapeTag::ARRAY_OPEN); }
 
-                if ('0' <= c && c <= '9') {
-                    token->push_back(c);
-                } else {
-                    strm.unget();
-                    return false;
-                }
+            bool end_array() { return close(TapeTag::ARRAY_CLOSE); }
 
+            /// True if the parse was aborted because the document does
+            /// not fit the tape.
+            bool too_large() const { return too_large_; }
+        };
+
+        /// A file's contents: mapped if it is a regular file, and read
+        /// into a buffer otherwise, since pipes, FIFOs, terminals and
+        /// /proc files cannot be mapped or report no size.
+        class MappedFile {
+            int fd_ = -1;
+            void *data_ = MAP_FAILED;
+            std::size_t size_ = 0;
+            std::string buffer_;
+            bool ok_ = false;
+
+            bool read_all() {
+                char chunk[64 * 1024];
                 for (;;) {
-                    char c = strm.get();
-                    if (strm.fail()) {
+                    ssize_t n = ::read(fd_, chunk, sizeof(chunk));
+                    if (n == 0) {
                         return true;
                     }
-
-                    if ('0' <= c && c <= '9') {
-                        token->push_back(c);
-                    } else {
-                        strm.unget();
-                        return true;
+                    if (n < 0) {
+                        if (errno == EINTR) {
+                            continue;
+                        }
+                        return false;
                     }
+                    buffer_.append(chunk, static_cast<std::size_t>(n));
                 }
             }
 
-            return true;
-        }
-
-        bool check_token(std::istream &strm, const char *expected) {
-            for (; *expected; ++expected) {
-                char c = strm.get();
-                if (strm.fail()) {
-                    return false;
+        public:
+            explicit MappedFile(const char *path) {
+                fd_ = ::open(path, O_RDONLY | O_CLOEXEC);
+                if (fd_ < 0) {
+                    return;
                 }
 
-                if (c != *expected) {
-                    return false;
+                struct stat st;
+                if (::fstat(fd_, &st) != 0) {
+                    return;
                 }
-            }
-
-            return true;
-        }
-
-        void skip_space(std::istream &strm) {
-            for (;;) {
-                char c = strm.get();
-                if (strm.fail()) {
+                if (!S_ISREG(st.st_mode)) {
+                    ok_ = read_all();
                     return;
                 }
-
-                if (!(c == ' ' || c == '\n' || c == '\r' || c == '\t')) {
-                    strm.unget();
+                size_ = static_cast<std::size_t>(st.st_size);
+                if (size_ == 0) {
+                    ok_ = true;
                     return;
                 }
-            }
-        }
-
-        class TokenResult {
-        public:
-            enum Error {
-                NIL_TOKEN,
-                END,
-                SYNTAX,
-            };
 
-        private:
-            bool success_;
-            union {
-                Token token_;
-                Error err_;
-            };
-
-        public:
-            TokenResult(Token &&tk) : token_(std::move(tk)) { success_ = true; }
-
-            TokenResult(Error err) : err_(err) { success_ = false; }
-
-            TokenResult(TokenResult &&tr) {
-                success_ = tr.success_;
-                if (tr.success_) {
-                    token_ = std::move(tr.token_);
-                } else {
-                    err_ = tr.err_;
+                data_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+                if (data_ != MAP_FAILED) {
+                    ::madvise(data_, size_, MADV_SEQUENTIAL);
+                    ok_ = true;
                 }
             }
 
-            TokenResult(const TokenResult &tr) {
-                success_ = tr.success_;
-                if (tr.success_) {
-                    token_ = tr.token_;
-                } else {
-                    err_ = tr.err_;
-                }
-            }
+            MappedFile(const MappedFile &) = delete;
+            MappedFile &operator=(const MappedFile &) = delete;
 
-            ~TokenResult() {
-                if (success_) {
-                    token_.~Token();
+            ~MappedFile() {
+                if (data_ != MAP_FAILED) {
+                    ::munmap(data_, size_);
+                }
+                if (fd_ >= 0) {
+                    ::close(fd_);
                 }
             }
 
-            operator bool() const { return success_; }
-
-            bool operator!() const { return !success_; }
-
-            Token operator*() const { return token_; }
-
-            Error get_error() const { return err_; }
-        };
-
-        TokenResult get_token(std::istream &strm) {
-            char c = strm.get();
-            if (strm.fail()) {
-                return TokenResult::Error::END;
-            }
+            /// True if the whole file could be read.  An empty file has no
+            /// mapping but is still ok.
+            bool ok() const { return ok_; }
 
-            std::string token;
-            token.push_back(c);
-
-            switch (c) {
-            case '[':
-                return Token(TokenType::ARRAY_OPEN, token);
-            case ']':
-                return Token(TokenType::ARRAY_CLOSE, token);
-            case '{':
-                return Token(TokenType::OBJ_OPEN, token);
-            case '}':
-                return Token(TokenType::OBJ_CLOSE, token);
-            case ':':
-                return Token(TokenType::COLON, token);
-            case ',':
-                return Token(TokenType::COMMA, token);
-            case '"':
-                if (!tokenize_string(strm, &token)) {
-                    return TokenResult::Error::SYNTAX;
-                }
-                return Token(TokenType::STRING, token);
-            case '-':
-            case '0':
-            case '1':
-            case '2':
-            case '3':
-            case '4':
-            case '5':
-            case '6':
-            case '7':
-            case '8':
-            case '9':
-                if (!tokenize_number(strm, &token)) {
-                    return TokenResult::Error::SYNTAX;
-                }
-                return Token(TokenType::NUMBER, token);
-            case 't':
-                strm.unget();
-                if (!check_token(strm, "true")) {
-                    return TokenResult::Error::SYNTAX;
+            std::string_view contents() const {
+                if (data_ == MAP_FAILED) {
+                    return buffer_;
                 }
-                return Token(TokenType::TRUE, "true");
-            case 'f':
-                strm.unget();
-                if (!check_token(strm, "false")) {
-                    return TokenResult::Error::SYNTAX;
-                }
-                return Token(TokenType::FALSE, "false");
-            case 'n':
-                strm.unget();
-                if (!check_token(strm, "null")) {
-                    return TokenResult::Error::SYNTAX;
-                }
-                return Token(TokenType::NULL_OBJ, "null");
-            case ' ':
-            case '\n':
-            case '\r':
-            case '\t':
-                skip_space(strm);
-                return TokenResult::Error::NIL_TOKEN;
-            default:
-                return TokenResult::Error::SYNTAX;
+                return {static_cast<const char *>(data_), size_};
             }
-        }
-
-        std::optional<std::vector<Token>> tokenize(std::istream &strm) {
-            std::vector<Token> result;
-            for (;;) {
-                TokenResult tk = get_token(strm);
-                if (!tk) {
-                    if (tk.get_error() == TokenResult::Error::END) {
-                        break;
-                    } else if (tk.get_error() ==
-                               TokenResult::Error::NIL_TOKEN) {
-                        continue;
-                    } else {
-                        return std::nullopt;
-                    }
-                }
+        };
 
-                result.push_back(*tk);
+        /// `source' is either empty or `input', in which case strings are
+        /// borrowed from it.  Keys go to `keys' if it is not null.
+        JSON_File parse_tree(std::string_view input, std::string_view source,
+                             KeyInterner *keys, int max_depth) {
+            JSON_File result;
+            TreeBuilder builder(result.get_arena(), source);
+            builder.set_keys(keys);
+            ParseError error;
+            if (parse_sax(input, builder, max_depth, &error)) {
+                result.set_root(builder.get_root());
+            } else {
+                result.set_error(error);
             }
             return result;
         }
+    } // namespace
 
-        JSON_Object *parse_object(std::vector<Token> tokens, size_t &index,
-                                  int limited_depth);
-        JSON_Array *parse_array(std::vector<Token> tokens, size_t &index,
-                                int limited_depth);
+    class PushParser::Impl {
+        JSON_File file_;
+        TreeBuilder builder_;
+        SaxPushParser<TreeBuilder> parser_;
 
-        JSON_Primitive *parse_primitive(std::vector<Token> tokens,
-                                        size_t &index, int limited_depth) {
-            if (index >= tokens.size()) {
-                return nullptr;
-            }
+    public:
+        explicit Impl(int max_depth)
+            : builder_(file_.get_arena()), parser_(builder_, max_depth) {}
 
-            if (tokens[index].get_type() == TokenType::TRUE ||
-                tokens[index].get_type() == TokenType::FALSE) {
-                JSON_Primitive *result =
-                    new JSON_Boolean(tokens[index].parse_boolean());
-                ++index;
-                return result;
-            } else if (tokens[index].get_type() == TokenType::NUMBER) {
-                JSON_Primitive *result;
-                try {
-                    result = new JSON_Number(tokens[index].parse_number());
-                } catch (std::out_of_range &) {
-                    return nullptr;
-                }
-                ++index;
-                return result;
-            } else if (tokens[index].get_type() == TokenType::STRING) {
-                std::string str = tokens[index].parse_string();
-                JSON_Primitive *result = new JSON_String(str);
-                ++index;
-                return result;
-            } else if (tokens[index].get_type() == TokenType::NULL_OBJ) {
-                JSON_Primitive *result = new JSON_Object(true);
-                ++index;
-                return result;
-            } else if (tokens[index].get_type() == TokenType::ARRAY_OPEN) {
-                return parse_array(tokens, index, limited_depth - 1);
-            } else if (tokens[index].get_type() == TokenType::OBJ_OPEN) {
-                return parse_object(tokens, index, limited_depth - 1);
-            }
-            return nullptr;
+        bool feed(const char *data, std::size_t size) {
+            return parser_.feed(data, size);
         }
 
-        JSON_Object *parse_object(std::vector<Token> tokens, size_t &index,
-                                  int limited_depth) {
-            if (limited_depth <= 0) {
-                return nullptr;
+        JSON_File finish() {
+            if (parser_.finish()) {
+                file_.set_root(builder_.get_root());
+            } else {
+                file_.set_error(parser_.error());
             }
+            return std::move(file_);
+        }
+    };
 
-            ++index;
+    PushParser::PushParser(int max_depth)
+        : impl_(std::make_unique<Impl>(max_depth)) {}
 
-#define CHECK_INDEX               \
-    if (index >= tokens.size()) { \
-        delete result;            \
-        return nullptr;           \
-    }
+    PushParser::PushParser(PushParser &&another) = default;
 
-            JSON_Object *result = new JSON_Object;
-            if (tokens[index].get_type() == TokenType::OBJ_CLOSE) {
-                ++index;
-                return result;
-            }
+    PushParser &PushParser::operator=(PushParser &&another) = default;
 
-            for (;;) {
-                CHECK_INDEX;
+    PushParser::~PushParser() = default;
 
-                if (tokens[index].get_type() != TokenType::STRING) {
-                    delete result;
-                    return nullptr;
-                }
-                std::string key = tokens[index].parse_string();
-                ++index;
+    bool PushParser::feed(const char *data, std::size_t size) {
+        return impl_->feed(data, size);
+    }
 
-                CHECK_INDEX;
+    JSON_File PushParser::finish() { return impl_->finish(); }
+
+    class Parser::Impl {
+        JSON_File file_;
+        detail::Lexer lexer_;
+        TreeBuilder builder_;
+        detail::Grammar<TreeBuilder> grammar_;
+        detail::BinaryDecoder binary_;
+        std::size_t high_water_mark_;
+
+    public:
+        Impl(int max_depth, std::size_t high_water_mark)
+            : lexer_({}), grammar_(builder_, max_depth),
+              high_water_mark_(high_water_mark) {}
+
+        const JSON_File &parse(std::string_view input,
+                               std::string_view source) {
+            reset();
+            lexer_.reset(input);
+            builder_.reset(file_.get_arena(), source);
+            grammar_.reset();
+            ParseError error;
+            if (detail::parse_document(input, lexer_, grammar_, &error)) {
+                file_.set_root(builder_.get_root());
+            } else {
+                file_.set_error(error);
+            }
+            return file_;
+        }
 
-                if (tokens[index].get_type() != TokenType::COLON) {
-                    delete result;
-                    return nullptr;
-                }
-                ++index;
+        const JSON_File &parse_binary(std::string_view input, bool borrow) {
+            reset();
+            binary_.decode(input, borrow, &file_);
+            return file_;
+        }
 
-                CHECK_INDEX;
+        void reset() {
+            std::size_t scratch = bytes_reserved() -
+                                  file_.get_arena().bytes_reserved();
+            file_.reset(scratch < high_water_mark_
+                            ? high_water_mark_ - scratch
+                            : 0);
+            if (bytes_reserved() > high_water_mark_) {
+                file_.get_arena().release();
+                lexer_.release_scratch();
+                builder_.release_scratch();
+                grammar_.release_scratch();
+                binary_.release_scratch();
+            }
+        }
 
-                JSON_Primitive *element =
-                    parse_primitive(tokens, index, limited_depth);
-                if (element == nullptr) {
-                    delete result;
-                    return nullptr;
-                }
+        void set_high_water_mark(std::size_t bytes) {
+            high_water_mark_ = bytes;
+        }
 
-                result->add(key, element);
+        std::size_t bytes_reserved() const {
+            return file_.get_arena().bytes_reserved() +
+                   lexer_.scratch_bytes() + builder_.scratch_bytes() +
+                   grammar_.scratch_bytes() + binary_.scratch_bytes();
+        }
+    };
 
-                CHECK_INDEX;
+    Parser::Parser(int max_depth, std::size_t high_water_mark)
+        : impl_(std::make_unique<Impl>(max_depth, high_water_mark)) {}
 
-                if (tokens[index].get_type() == TokenType::COMMA) {
-                    ++index;
-                    continue;
-                } else if (tokens[index].get_type() == TokenType::OBJ_CLOSE) {
-                    ++index;
-                    return result;
-                } else {
-                    delete result;
-                    return nullptr;
-                }
-            }
+    Parser::Parser(Parser &&another) = default;
 
-#undef CHECK_INDEX
+    Parser &Parser::operator=(Parser &&another) = default;
 
-            return result;
-        }
+    Parser::~Parser() = default;
 
-        JSON_Array *parse_array(std::vector<Token> tokens, size_t &index,
-                                int limited_depth) {
-            if (limited_depth <= 0) {
-                return nullptr;
-            }
+    const JSON_File &Parser::parse(std::string_view input) {
+        return impl_->parse(input, {});
+    }
 
-            ++index;
+    const JSON_File &Parser::parse_borrowed(std::string_view input) {
+        return impl_->parse(input, input);
+    }
 
-#define CHECK_INDEX               \
-    if (index >= tokens.size()) { \
-        delete result;            \
-        return nullptr;           \
+    const JSON_File &Parser::parse_binary(std::string_view input) {
+        return impl_->parse_binary(input, false);
     }
 
-            JSON_Array *result = new JSON_Array;
-            if (tokens[index].get_type() == TokenType::ARRAY_CLOSE) {
-                ++index;
-                return result;
-            }
+    const JSON_File &Parser::parse_binary_borrowed(std::string_view input) {
+        return impl_->parse_binary(input, true);
+    }
 
-            for (;;) {
-                CHECK_INDEX;
+    void Parser::reset() { impl_->reset(); }
 
-                JSON_Primitive *element =
-                    parse_primitive(tokens, index, limited_depth);
-                if (element == nullptr) {
-                    delete result;
-                    return nullptr;
-                }
+    void Parser::set_high_water_mark(std::size_t bytes) {
+        impl_->set_high_water_mark(bytes);
+    }
 
-                result->append(element);
+    std::size_t Parser::bytes_reserved() const {
+        return impl_->bytes_reserved();
+    }
 
-                CHECK_INDEX;
+    const char *ParseError::message() const {
+        switch (code) {
+        case ParseErrorCode::NONE:
+            return "no error";
+        case ParseErrorCode::EMPTY_INPUT:
+            return "empty input";
+        case ParseErrorCode::UNEXPECTED_END:
+            return "unexpected end of input";
+        case ParseErrorCode::UNEXPECTED_CHARACTER:
+            return "unexpected character";
+        case ParseErrorCode::UNEXPECTED_TOKEN:
+            return "unexpected token";
+        case ParseErrorCode::INVALID_LITERAL:
+            return "invalid literal";
+        case ParseErrorCode::INVALID_NUMBER:
+            return "invalid number";
+        case ParseErrorCode::NUMBER_OUT_OF_RANGE:
+            return "number out of range";
+        case ParseErrorCode::CONTROL_CHARACTER:
+            return "unescaped control character in string";
+        case ParseErrorCode::INVALID_ESCAPE:
+            return "invalid escape";
+        case ParseErrorCode::INVALID_UTF8:
+            return "invalid UTF-8";
+        case ParseErrorCode::TOO_DEEP:
+            return "nesting too deep";
+        case ParseErrorCode::TRAILING_CONTENT:
+            return "content after the document";
+        case ParseErrorCode::HANDLER_ABORTED:
+            return "aborted by the handler";
+        case ParseErrorCode::TYPE_MISMATCH:
+            return "value does not match the type";
+        case ParseErrorCode::INVALID_BINARY:
+            return "malformed binary document";
+        case ParseErrorCode::TOO_LARGE:
+            return "document too large for the tape";
+        case ParseErrorCode::NOT_FOUND:
+            return "no value at the pointer";
+        case ParseErrorCode::IO_ERROR:
+            return "input could not be read";
+        }
+        return "unknown error";
+    }
 
-                if (tokens[index].get_type() == TokenType::COMMA) {
-                    ++index;
-                    continue;
-                } else if (tokens[index].get_type() == TokenType::ARRAY_CLOSE) {
-                    ++index;
-                    return result;
-                } else {
-                    delete result;
-                    return nullptr;
-                }
+    JSON_File parse(std::istream &strm, int max_depth) {
+        PushParser parser(max_depth);
+        char chunk[64 * 1024];
+        while (strm) {
+            strm.read(chunk, sizeof(chunk));
+            if (!parser.feed(chunk, static_cast<std::size_t>(strm.gcount()))) {
+                break;
             }
-
-#undef CHECK_INDEX
-
+        }
+        if (strm.bad()) {
+            JSON_File result;
+            result.set_error({ParseErrorCode::IO_ERROR});
             return result;
         }
-    } // namespace
+        return parser.finish();
+    }
 
-    JSON_File parse(std::istream &strm, int max_depth) {
-        auto tokenized = tokenize(strm);
+    JSON_File parse(std::string_view input, int max_depth) {
+        return parse_tree(input, {}, nullptr, max_depth);
+    }
+
+    JSON_File parse(std::string_view input,
+                    const std::shared_ptr<KeyInterner> &keys, int max_depth) {
+        JSON_File result = parse_tree(input, {}, keys.get(), max_depth);
+        result.set_source(keys);
+        return result;
+    }
+
+    JSON_File parse_borrowed(std::string_view input, int max_depth) {
+        return parse_tree(input, input, nullptr, max_depth);
+    }
 
-        JSON_File result;
-        if (!tokenized || tokenized->size() == 0) {
+    JSON_File parse_file(const char *path, int max_depth) {
+        auto file = std::make_shared<const MappedFile>(path);
+        if (!file->ok()) {
+            JSON_File result;
+            result.set_error({ParseErrorCode::IO_ERROR});
             return result;
         }
+        JSON_File result = parse_borrowed(file->contents(), max_depth);
+        result.set_source(std::move(file));
+        return result;
+    }
 
-        std::vector<Token> tokens = *tokenized;
-        std::size_t index = 0;
-        JSON_Primitive *root = parse_primitive(tokens, index, max_depth);
-        if (index != tokens.size()) {
-            delete root;
-            root = nullptr;
+    Tape parse_tape(std::string_view input, int max_depth) {
+        Tape result;
+        TapeBuilder builder(result.words_, result.strings_);
+        result.ok_ = parse_sax(input, builder, max_depth, &result.error_);
+        if (builder.too_large()) {
+            result.error_.code = ParseErrorCode::TOO_LARGE;
         }
-
-        if (root != nullptr) {
-            result.set_root(root);
+        if (!result.ok_) {
+            result.words_.clear();
+            result.strings_.clear();
         }
-
         return result;
     }
 } // namespace json
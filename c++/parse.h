@@ -2,158 +2,687 @@
 #ifndef PARSE_H
 #define PARSE_H
 
-#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
-#include <unordered_map>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "arena.h"
+#include "intern.h"
+#include "stats.h"
 
 namespace json {
     enum class JSON_Type { BOOLEAN, NUMBER, STRING, OBJECT, ARRAY };
 
+    /// Base of all nodes.  Nodes are allocated in the Arena of the JSON_File
+    /// that owns them and are never destroyed individually, so there is no
+    /// vtable: the dynamic type is the JSON_Type tag, and the subclass can be
+    /// recovered with a static_cast.
     class JSON_Primitive {
+        JSON_Type type_;
+
+    protected:
+        explicit JSON_Primitive(JSON_Type type) : type_(type) {}
+
     public:
-        virtual ~JSON_Primitive() {}
-        virtual JSON_Type get_type() const = 0;
-        virtual std::string to_string() const = 0;
+        JSON_Type get_type() const { return type_; }
+
+        /// Serializes the subtree as compact JSON with a Writer (writer.h).
+        std::string to_string() const;
     };
 
     class JSON_Boolean : public JSON_Primitive {
         bool value_;
 
     public:
-        JSON_Boolean(bool value) : value_(value) {}
-
-        JSON_Type get_type() const override { return JSON_Type::BOOLEAN; }
-
-        std::string to_string() const override {
-            if (value_) {
-                return "true";
-            } else {
-                return "false";
-            }
-        }
+        JSON_Boolean(bool value)
+            : JSON_Primitive(JSON_Type::BOOLEAN), value_(value) {}
 
         bool get_value() const { return value_; }
     };
 
     class JSON_Number : public JSON_Primitive {
-        double value_;
+    public:
+        /// How the value is stored.  Integers that fit in 64 bits are kept
+        /// exact; everything else is a double.
+        enum class Kind { INT64, UINT64, DOUBLE };
+
+    private:
+        Kind kind_;
+        union {
+            std::int64_t int64_;
+            std::uint64_t uint64_;
+            double double_;
+        };
 
     public:
-        JSON_Number(double value) : value_(value) {}
+        JSON_Number(double value)
+            : JSON_Primitive(JSON_Type::NUMBER), kind_(Kind::DOUBLE),
+              double_(value) {}
+
+        JSON_Number(std::int64_t value)
+            : JSON_Primitive(JSON_Type::NUMBER), kind_(Kind::INT64),
+              int64_(value) {}
+
+        JSON_Number(std::uint64_t value)
+            : JSON_Primitive(JSON_Type::NUMBER), kind_(Kind::UINT64),
+              uint64_(value) {}
+
+        Kind get_kind() const { return kind_; }
+
+        /// The value as a double.  Integers beyond 2^53 may be rounded.
+        double get_value() const {
+            switch (kind_) {
+            case Kind::INT64:
+                return static_cast<double>(int64_);
+            case Kind::UINT64:
+                return static_cast<double>(uint64_);
+            default:
+                return double_;
+            }
+        }
 
-        JSON_Type get_type() const override { return JSON_Type::NUMBER; }
+        /// Only meaningful if get_kind() is Kind::INT64.
+        std::int64_t get_int64() const { return int64_; }
 
-        std::string to_string() const override {
-            return std::to_string(value_);
-        }
+        /// Only meaningful if get_kind() is Kind::UINT64.
+        std::uint64_t get_uint64() const { return uint64_; }
     };
 
     class JSON_String : public JSON_Primitive {
-        std::string value_;
+        std::string_view value_;
 
     public:
-        JSON_String(std::string value) : value_(value) {}
+        /// `value' must outlive the node; the parser points it into the
+        /// document's arena.
+        JSON_String(std::string_view value)
+            : JSON_Primitive(JSON_Type::STRING), value_(value) {}
 
-        JSON_Type get_type() const override { return JSON_Type::STRING; }
+        std::string_view get_value() const { return value_; }
+    };
 
-        std::string to_string() const override { return "\"" + value_ + "\""; }
+    struct JSON_Member {
+        std::string_view key;
+        const JSON_Primitive *value;
     };
 
+    class TreeBuilder;
+
+    namespace detail {
+        class BinaryDecoder;
+    } // namespace detail
+
+    /// Members are kept in insertion order in a contiguous array in the
+    /// arena.  Small objects are searched linearly; once an object has more
+    /// than INDEX_THRESHOLD members a hash index (open addressing over
+    /// member positions) is built and maintained alongside the array.
+    /// Lookups never modify the object, so a finished object may be read
+    /// from several threads at once.  Only the builders that fill it can
+    /// add members.
     class JSON_Object : public JSON_Primitive {
+    public:
+        static constexpr std::size_t INDEX_THRESHOLD = 16;
+
+    private:
+        static constexpr std::uint32_t NOT_FOUND = ~std::uint32_t(0);
+
         bool null_object_ = false;
-        std::unordered_map<std::string, JSON_Primitive *> children;
+        Arena *arena_ = nullptr;
+        JSON_Member *members_ = nullptr;
+        std::uint32_t size_ = 0;
+        std::uint32_t capacity_ = 0;
+        // Slots hold a member position + 1; 0 marks an empty slot.
+        std::uint32_t *index_ = nullptr;
+        std::uint32_t index_mask_ = 0;
+
+        static std::size_t hash(std::string_view key) {
+            return std::hash<std::string_view>()(key);
+        }
 
-    public:
-        explicit JSON_Object(bool nullobj) : null_object_(nullobj) {}
+        /// Keys from the same KeyInterner (intern.h) are equal exactly if
+        /// they are the same pointer.
+        static bool same_key(std::string_view a, std::string_view b) {
+            return a.size() == b.size() &&
+                   (a.data() == b.data() ||
+                    std::memcmp(a.data(), b.data(), a.size()) == 0);
+        }
 
-        JSON_Object() = default;
+        std::uint32_t find(std::string_view key) const {
+            if (index_ == nullptr) {
+                for (std::uint32_t i = 0; i < size_; ++i) {
+                    if (same_key(members_[i].key, key)) {
+                        return i;
+                    }
+                }
+                return NOT_FOUND;
+            }
+
+            for (std::size_t slot = hash(key) & index_mask_;;
+                 slot = (slot + 1) & index_mask_) {
+                if (index_[slot] == 0) {
+                    return NOT_FOUND;
+                }
+                if (same_key(members_[index_[slot] - 1].key, key)) {
+                    return index_[slot] - 1;
+                }
+            }
+        }
 
-        JSON_Type get_type() const override { return JSON_Type::OBJECT; }
+        void index_member(std::uint32_t position) {
+            std::size_t slot = hash(members_[position].key) & index_mask_;
+            while (index_[slot] != 0) {
+                slot = (slot + 1) & index_mask_;
+            }
+            index_[slot] = position + 1;
+        }
+
+        /// (Re)builds the index with room for `count' members at a load
+        /// factor of at most 1/2.
+        void build_index(std::size_t count) {
+            std::size_t slots = 2 * INDEX_THRESHOLD;
+            while (slots < 2 * count) {
+                slots *= 2;
+            }
+            index_ = static_cast<std::uint32_t *>(arena_->allocate_raw(
+                slots * sizeof(std::uint32_t), alignof(std::uint32_t)));
+            std::memset(index_, 0, slots * sizeof(std::uint32_t));
+            index_mask_ = static_cast<std::uint32_t>(slots - 1);
+            for (std::uint32_t i = 0; i < size_; ++i) {
+                index_member(i);
+            }
+        }
 
-        bool is_null() { return null_object_; }
+        /// Inserts or replaces without growing the member array.
+        void insert(std::string_view key, const JSON_Primitive *element) {
+            std::uint32_t found = find(key);
+            if (found != NOT_FOUND) {
+                members_[found].value = element;
+                return;
+            }
 
-        void add(const std::string &key, JSON_Primitive *element) {
-            children[key] = element;
+            members_[size_] = {key, element};
+            ++size_;
+            if (index_ != nullptr) {
+                if (2 * size_ > index_mask_ + 1) {
+                    build_index(size_);
+                } else {
+                    index_member(size_ - 1);
+                }
+            } else if (size_ > INDEX_THRESHOLD) {
+                build_index(size_);
+            }
         }
 
-        std::string to_string() const override {
-            if (null_object_) {
-                return "null";
+        /// `key' must outlive the object.  A later value for the same key
+        /// replaces the earlier one but keeps the original position.
+        void add(std::string_view key, const JSON_Primitive *element) {
+            if (size_ == capacity_) {
+                std::uint32_t capacity = capacity_ == 0 ? 4 : 2 * capacity_;
+                auto *members = static_cast<JSON_Member *>(arena_->allocate_raw(
+                    capacity * sizeof(JSON_Member), alignof(JSON_Member)));
+                std::copy(members_, members_ + size_, members);
+                members_ = members;
+                capacity_ = capacity;
             }
+            insert(key, element);
+        }
+
+        /// Replaces the contents with `count' members, applying add() to
+        /// each in turn but allocating the member array only once.
+        void assign(const JSON_Member *members, std::size_t count) {
+            adopt(arena_->copy(members, count), count);
+        }
 
-            std::string result;
-            result.push_back('{');
-            for (auto &e : children) {
-                result.push_back('"');
-                result.insert(result.end(), e.first.begin(), e.first.end());
-                result.push_back('"');
-                result.push_back(':');
-                std::string repr = e.second->to_string();
-                result.insert(result.end(), repr.begin(), repr.end());
-                result.push_back(',');
+        /// Like assign(), but uses `members' itself as the member array,
+        /// so it must outlive the object, and merges duplicate keys in
+        /// place.
+        void adopt(JSON_Member *members, std::size_t count) {
+            members_ = members;
+            size_ = 0;
+            capacity_ = static_cast<std::uint32_t>(count);
+            index_ = nullptr;
+            if (count > INDEX_THRESHOLD) {
+                build_index(count);
+            }
+            for (std::size_t i = 0; i < count; ++i) {
+                insert(members[i].key, members[i].value);
             }
-            result.push_back('}');
-            return result;
         }
+
+        friend class TreeBuilder;
+        friend class detail::BinaryDecoder;
+
+    public:
+        explicit JSON_Object(bool nullobj)
+            : JSON_Primitive(JSON_Type::OBJECT), null_object_(nullobj) {}
+
+        /// Members, and the index once there is one, are allocated in
+        /// `arena', normally the document's.
+        explicit JSON_Object(Arena *arena)
+            : JSON_Primitive(JSON_Type::OBJECT), arena_(arena) {}
+
+        bool is_null() const { return null_object_; }
+
+        std::size_t size() const { return size_; }
+
+        /// Returns nullptr if there is no member named `key'.
+        const JSON_Primitive *get(std::string_view key) const {
+            std::uint32_t found = find(key);
+            return found == NOT_FOUND ? nullptr : members_[found].value;
+        }
+
+        const JSON_Member *begin() const { return members_; }
+
+        const JSON_Member *end() const { return members_ + size_; }
     };
 
     class JSON_Array : public JSON_Primitive {
-        std::vector<JSON_Primitive *> elements;
+        const JSON_Primitive *const *elements_ = nullptr;
+        std::size_t size_ = 0;
 
     public:
-        JSON_Type get_type() const override { return JSON_Type::ARRAY; }
-
-        std::string to_string() const override {
-            std::string result;
-            result.push_back('[');
-            for (auto &e : elements) {
-                std::string repr = e->to_string();
-                result.insert(result.end(), repr.begin(), repr.end());
-                result.push_back(',');
-            }
-            result.push_back(']');
-            return result;
+        JSON_Array() : JSON_Primitive(JSON_Type::ARRAY) {}
+
+        /// `elements' must outlive the array; the parser allocates it in
+        /// the document's arena.
+        JSON_Array(const JSON_Primitive *const *elements, std::size_t size)
+            : JSON_Primitive(JSON_Type::ARRAY), elements_(elements),
+              size_(size) {}
+
+        std::size_t size() const { return size_; }
+
+        const JSON_Primitive *get(std::size_t index) const {
+            return elements_[index];
         }
 
-        void append(JSON_Primitive *element) {
-            elements.push_back(element);
+        const JSON_Primitive *const *begin() const { return elements_; }
+
+        const JSON_Primitive *const *end() const { return elements_ + size_; }
+    };
+
+    enum class ParseErrorCode {
+        NONE,
+        EMPTY_INPUT,          // nothing but whitespace
+        UNEXPECTED_END,       // the input ends inside the document
+        UNEXPECTED_CHARACTER, // a byte that cannot start a token
+        UNEXPECTED_TOKEN,     // a valid token where it is not allowed
+        INVALID_LITERAL,      // a misspelt true, false or null
+        INVALID_NUMBER,
+        NUMBER_OUT_OF_RANGE,  // too large or too small for a double
+        CONTROL_CHARACTER,    // unescaped, in a string
+        INVALID_ESCAPE,       // also an unpaired surrogate, see sax.h
+        INVALID_UTF8,         // in a string
+        TOO_DEEP,             // nested deeper than max_depth allows
+        TRAILING_CONTENT,     // more after the root value
+        HANDLER_ABORTED,      // a parse_sax() handler returned false
+        TYPE_MISMATCH,        // a value that parse_into() cannot store
+        INVALID_BINARY,       // malformed parse_binary() input
+        TOO_LARGE,            // beyond the limits of parse_tape() (tape.h)
+        NOT_FOUND,            // no value at a JSON Pointer (ondemand.h)
+        IO_ERROR,             // the file or stream could not be read
+    };
+
+    /// Why and where a parse failed.  The offset is of the byte at fault:
+    /// the start of the offending token, the offending byte inside a
+    /// string, or the end of the input.  Lines and columns count from 1,
+    /// and columns count bytes.
+    struct ParseError {
+        ParseErrorCode code = ParseErrorCode::NONE;
+        std::size_t offset = 0;
+        std::size_t line = 0;
+        std::size_t column = 0;
+
+        explicit operator bool() const {
+            return code != ParseErrorCode::NONE;
         }
+
+        /// A short description of `code', e.g. "invalid escape".
+        const char *message() const;
     };
 
+    /// A parsed document.  Every node, string and child array of the tree
+    /// lives in the file's arena and is freed together with it.  To share
+    /// one between threads, see SharedDocument (shared.h).
     class JSON_File {
         bool ok_ = false;
         JSON_Primitive *root_ = nullptr;
+        ParseError error_;
+        Arena arena_;
+        // Keeps alive the buffer that strings and keys may point into.
+        std::shared_ptr<const void> source_;
 
     public:
         JSON_File() = default;
 
-        JSON_File(JSON_File &&another): ok_(another.ok_), root_(another.root_) {
+        JSON_File(JSON_File &&another)
+            : ok_(another.ok_), root_(another.root_), error_(another.error_),
+              arena_(std::move(another.arena_)),
+              source_(std::move(another.source_)) {
             another.ok_ = false;
             another.root_ = nullptr;
         }
 
-        ~JSON_File() { delete root_; }
-
         bool ok() const { return ok_; }
 
+        /// `root' must have been allocated in get_arena(), or in memory kept
+        /// alive by set_source().
         void set_root(JSON_Primitive *root) {
             ok_ = true;
-            delete root_;
             root_ = root;
         }
 
-        const JSON_Primitive *get_root() { return root_; }
+        const JSON_Primitive *get_root() const { return root_; }
+
+        /// Why ok() is false.  The code is NONE if the document was never
+        /// parsed or the failure has no more specific cause.
+        const ParseError &get_error() const { return error_; }
+
+        void set_error(const ParseError &error) { error_ = error; }
+
+        Arena &get_arena() { return arena_; }
+
+        const Arena &get_arena() const { return arena_; }
+
+        /// Ties the lifetime of `source' to the document, for when the tree
+        /// refers into it.
+        void set_source(std::shared_ptr<const void> source) {
+            source_ = std::move(source);
+        }
+
+        /// Empties the document for reuse.  The arena keeps its newest block,
+        /// and older ones up to `keep_bytes' in all (see Arena::reset()), so
+        /// a document of similar size can be built without allocating.
+        void reset(std::size_t keep_bytes = 0) {
+            ok_ = false;
+            root_ = nullptr;
+            error_ = ParseError();
+            arena_.reset(keep_bytes);
+            source_.reset();
+        }
 
         JSON_File &operator=(JSON_File &&another) {
             ok_ = another.ok_;
             root_ = another.root_;
+            error_ = another.error_;
+            arena_ = std::move(another.arena_);
+            source_ = std::move(another.source_);
             another.ok_ = false;
             another.root_ = nullptr;
             return *this;
         }
     };
 
-    JSON_File parse(std::istream &strm, int max_dept = 64);
+    /// The parse_sax() handler (sax.h) that builds a JSON_Primitive tree in
+    /// an arena; parse() is parse_sax() with a TreeBuilder.  Children of the
+    /// containers that are still open are kept on scratch stacks and copied
+    /// into the arena, at their final size, when the container closes.
+    /// Strings that lie inside `source' are referenced rather than copied.
+    class TreeBuilder {
+        struct Frame {
+            std::size_t mark;
+            bool object;
+        };
+
+        Arena *arena_;
+        std::string_view source_;
+        KeyInterner *keys_ = nullptr;
+        JSON_Primitive *root_ = nullptr;
+        std::vector<JSON_Primitive *> values_;
+        // A member is pushed with a null value when its key is seen and
+        // completed by add().
+        std::vector<JSON_Member> members_;
+        std::vector<Frame> frames_;
+
+        // See stats.h; null unless parse() was given a ParseStats.
+        detail::StatsRecorder *stats_ = nullptr;
+
+        bool add(JSON_Primitive *node) {
+            if (frames_.empty()) {
+                root_ = node;
+            } else if (frames_.back().object) {
+                members_.back().value = node;
+            } else {
+                detail::stats_track(stats_, values_,
+                                    [&] { values_.push_back(node); });
+            }
+            return true;
+        }
+
+        std::string_view keep(std::string_view str) {
+            std::less_equal<const char *> le;
+            if (le(source_.data(), str.data()) &&
+                le(str.data() + str.size(),
+                   source_.data() + source_.size())) {
+                return str;
+            }
+            return arena_->copy(str);
+        }
+
+    public:
+        explicit TreeBuilder(Arena &arena, std::string_view source = {})
+            : arena_(&arena), source_(source) {}
+
+        /// reset() must be called before the first event.
+        TreeBuilder() : arena_(nullptr) {}
+
+        /// Starts over with a new document built in `arena', borrowing
+        /// strings from `source'.  The scratch stacks keep their capacity.
+        void reset(Arena &arena, std::string_view source = {}) {
+            arena_ = &arena;
+            source_ = source;
+            root_ = nullptr;
+            values_.clear();
+            members_.clear();
+            frames_.clear();
+        }
+
+        /// Bytes held by the scratch stacks.
+        std::size_t scratch_bytes() const {
+            return values_.capacity() * sizeof(JSON_Primitive *) +
+                   members_.capacity() * sizeof(JSON_Member) +
+                   frames_.capacity() * sizeof(Frame);
+        }
+
+        /// Frees the scratch stacks.
+        void release_scratch() {
+            std::vector<JSON_Primitive *>().swap(values_);
+            std::vector<JSON_Member>().swap(members_);
+            std::vector<Frame>().swap(frames_);
+        }
+
+        /// Stores keys in `keys', which must outlive the documents built,
+        /// instead of the arena; nullptr goes back to the arena.
+        void set_keys(KeyInterner *keys) { keys_ = keys; }
+
+        /// Counts the growth of the scratch stacks in `stats', which may
+        /// be null, from now on.
+        void set_stats(detail::StatsRecorder *stats) { stats_ = stats; }
+
+        JSON_Primitive *get_root() const { return root_; }
+
+        bool value(std::nullptr_t) {
+            return add(arena_->make<JSON_Object>(true));
+        }
+
+        bool value(bool b) {
+            return add(arena_->make<JSON_Boolean>(b));
+        }
+
+        bool value(std::int64_t n) {
+            return add(arena_->make<JSON_Number>(n));
+        }
+
+        bool value(std::uint64_t n) {
+            return add(arena_->make<JSON_Number>(n));
+        }
+
+        bool value(double n) {
+            return add(arena_->make<JSON_Number>(n));
+        }
+
+        bool value(std::string_view str) {
+            return add(arena_->make<JSON_String>(keep(str)));
+        }
+
+        bool start_object() {
+            detail::stats_track(stats_, frames_, [&] {
+                frames_.push_back({members_.size(), true});
+            });
+            return true;
+        }
+
+        bool key(std::string_view key) {
+            std::string_view kept =
+                keys_ != nullptr ? keys_->intern(key) : keep(key);
+            detail::stats_track(stats_, members_, [&] {
+                members_.push_back({kept, nullptr});
+            });
+            return true;
+        }
+
+        bool end_object() {
+            std::size_t mark = frames_.back().mark;
+            frames_.pop_back();
+
+            JSON_Object *object = arena_->make<JSON_Object>(arena_);
+            object->assign(members_.data() + mark, members_.size() - mark);
+            members_.resize(mark);
+            return add(object);
+        }
+
+        bool start_array() {
+            detail::stats_track(stats_, frames_, [&] {
+                frames_.push_back({values_.size(), false});
+            });
+            return true;
+        }
+
+        bool end_array() {
+            std::size_t mark = frames_.back().mark;
+            frames_.pop_back();
+
+            std::size_t size = values_.size() - mark;
+            JSON_Array *array = arena_->make<JSON_Array>(
+                arena_->copy(values_.data() + mark, size), size);
+            values_.resize(mark);
+            return add(array);
+        }
+    };
+
+    /// A max_depth that lets any document through.
+    constexpr int UNLIMITED_DEPTH = std::numeric_limits<int>::max();
+
+    /// Reads the stream to its end in chunks and parses them as they
+    /// arrive, with a PushParser.  The chunks are not kept, so every
+    /// string and key is copied into the document's arena, as by parse().
+    JSON_File parse(std::istream &strm, int max_depth = 64);
+
+    /// Parses a JSON text held in a contiguous buffer.  The buffer only has
+    /// to stay alive for the duration of the call; every string and key is
+    /// copied into the document's arena.
+    ///
+    /// Containers may be nested at most max_depth - 1 levels deep.  The
+    /// parser does not recurse: open containers are kept on stacks in the
+    /// heap, at a few bytes per level, and so are they when a tree is
+    /// written out.  The limit therefore only bounds the memory a hostile
+    /// input can take and may be raised as far as documents need, up to
+    /// UNLIMITED_DEPTH.
+    JSON_File parse(std::string_view input, int max_depth = 64);
+
+    /// Like parse(), but keys are interned in `keys' (intern.h), which the
+    /// document keeps alive.  Passing the same KeyInterner to many parses
+    /// stores each key once for all of their documents.
+    JSON_File parse(std::string_view input,
+                    const std::shared_ptr<KeyInterner> &keys,
+                    int max_depth = 64);
+
+    /// Like parse(), but strings and keys without escapes are views into
+    /// `input' rather than copies, so `input' must outlive the returned
+    /// JSON_File.  Strings with escapes are decoded into the arena.
+    JSON_File parse_borrowed(std::string_view input, int max_depth = 64);
+
+    /// Parses a document that arrives in pieces, e.g. from a socket.  Every
+    /// token that is complete is consumed as soon as it is fed, so only a
+    /// token cut off at the end of the input seen so far is buffered.  The
+    /// tree is built as by parse().
+    class PushParser {
+        class Impl;
+        std::unique_ptr<Impl> impl_;
+
+    public:
+        explicit PushParser(int max_depth = 64);
+        PushParser(PushParser &&another);
+        PushParser &operator=(PushParser &&another);
+        ~PushParser();
+
+        /// Returns false once the input seen so far cannot be the start of
+        /// a document; later calls do nothing.
+        bool feed(const char *data, std::size_t size);
+
+        /// Ends the input.  The result's ok() is false unless the whole
+        /// input was exactly one document.  The parser cannot be fed again.
+        JSON_File finish();
+    };
+
+    /// Parses one document after another, keeping what a parse allocates
+    /// for the next: the document's arena, the scratch stacks of the tree
+    /// builder, the depth stack and the buffer for unescaped strings.  Once
+    /// these have grown to fit the documents, parsing allocates nothing, as
+    /// long as they fit under the high-water mark together.  The document
+    /// belongs to the parser and lives until the next parse() or reset().
+    /// reset() keeps at most the high-water mark, so one huge document does
+    /// not pin its memory for good; if the arena's newest block and the
+    /// scratch buffers alone exceed it, everything is freed.
+    class Parser {
+        class Impl;
+        std::unique_ptr<Impl> impl_;
+
+    public:
+        static constexpr std::size_t DEFAULT_HIGH_WATER_MARK = 1 << 20;
+
+        /// max_depth has the meaning documented for parse().
+        explicit Parser(int max_depth = 64,
+                        std::size_t high_water_mark = DEFAULT_HIGH_WATER_MARK);
+        Parser(Parser &&another);
+        Parser &operator=(Parser &&another);
+        ~Parser();
+
+        /// Like json::parse(), after a reset().
+        const JSON_File &parse(std::string_view input);
+
+        /// Like json::parse_borrowed(), after a reset().
+        const JSON_File &parse_borrowed(std::string_view input);
+
+        /// Like json::parse_binary() (binary.h), after a reset().
+        const JSON_File &parse_binary(std::string_view input);
+
+        /// Like json::parse_binary_borrowed(), after a reset().
+        const JSON_File &parse_binary_borrowed(std::string_view input);
+
+        /// Drops the document.  Its memory is kept for the next one unless
+        /// the parser holds more than the high-water mark, in which case
+        /// all of it is freed.
+        void reset();
+
+        void set_high_water_mark(std::size_t bytes);
+
+        /// Bytes the parser holds between documents: the arena and the
+        /// scratch buffers.
+        std::size_t bytes_reserved() const;
+    };
+
+    /// Memory-maps the file at `path' and parses its contents as
+    /// parse_borrowed() does.  The mapping lives as long as the returned
+    /// JSON_File, whose ok() is false if the file cannot be read.  Files
+    /// that cannot be mapped, such as pipes and /dev/stdin, are read into
+    /// a buffer that the JSON_File keeps instead.
+    JSON_File parse_file(const char *path, int max_depth = 64);
 } // namespace json
 
 #endif
@@ -0,0 +1,1171 @@
+/* -*- mode: c++ -*- */
+#ifndef SAX_H
+#define SAX_H
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "json_config.h"
+#include "number.h"
+#include "parse.h"
+#include "scan.h"
+#include "stats.h"
+
+// Event-based parsing.  The parser drives a handler, a class of any type
+// with the members
+//
+//   bool start_object();
+//   bool key(std::string_view key);
+//   bool end_object();
+//   bool start_array();
+//   bool end_array();
+//   bool value(std::nullptr_t);
+//   bool value(bool b);
+//   bool value(std::int64_t n);
+//   bool value(std::uint64_t n);
+//   bool value(double n);
+//   bool value(std::string_view str);
+//
+// each returning false to abort the parse.  Numbers arrive as int64 or
+// uint64 when they are integers that fit, and as double otherwise.  String
+// views hold the unescaped text and are only valid during the call.  Since
+// the parser is a template over the handler, the calls are inlined and
+// nothing is allocated on behalf of the handler; json::TreeBuilder
+// (parse.h) is the handler behind json::parse().
+
+namespace json::detail {
+    enum class TokenType {
+        ARRAY_OPEN,
+        ARRAY_CLOSE,
+        OBJ_OPEN,
+        OBJ_CLOSE,
+        COLON,
+        COMMA,
+        STRING,
+        NUMBER,
+        TRUE,
+        FALSE,
+        NULL_OBJ,
+    };
+
+    class Token {
+        TokenType type_;
+        // For strings this is the unescaped contents without the
+        // quotes; for every other token it is the source text.
+        std::string_view token_;
+        // Converted value of a NUMBER token.
+        JSON_Number number_{0.0};
+
+    public:
+        Token(TokenType type, std::string_view token)
+            : type_(type), token_(token) {}
+
+        Token(std::string_view token, const JSON_Number &number)
+            : type_(TokenType::NUMBER), token_(token), number_(number) {}
+
+        TokenType get_type() const { return type_; }
+
+        std::string_view get_token() const { return token_; }
+
+        bool parse_boolean() const { return token_[0] == 't'; }
+
+        std::string parse_string() const { return std::string(token_); }
+
+        const JSON_Number &parse_number() const { return number_; }
+    };
+
+    class TokenResult {
+    public:
+        enum Error {
+            END,
+            SYNTAX,
+            // The token runs into the end of a non-final buffer and
+            // needs more input to be decided.
+            INCOMPLETE,
+        };
+
+    private:
+        bool success_;
+        union {
+            Token token_;
+            Error err_;
+        };
+
+    public:
+        TokenResult(Token &&tk) : token_(std::move(tk)) { success_ = true; }
+
+        TokenResult(Error err) : err_(err) { success_ = false; }
+
+        TokenResult(TokenResult &&tr) {
+            success_ = tr.success_;
+            if (tr.success_) {
+                new (&token_) Token(std::move(tr.token_));
+            } else {
+                err_ = tr.err_;
+            }
+        }
+
+        TokenResult(const TokenResult &tr) {
+            success_ = tr.success_;
+            if (tr.success_) {
+                new (&token_) Token(tr.token_);
+            } else {
+                err_ = tr.err_;
+            }
+        }
+
+        TokenResult &operator=(TokenResult &&tr) {
+            if (success_ && tr.success_) {
+                token_ = std::move(tr.token_);
+            } else if (success_) {
+                token_.~Token();
+                err_ = tr.err_;
+            } else if (tr.success_) {
+                new (&token_) Token(std::move(tr.token_));
+            } else {
+                err_ = tr.err_;
+            }
+            success_ = tr.success_;
+            return *this;
+        }
+
+        ~TokenResult() {
+            if (success_) {
+                token_.~Token();
+            }
+        }
+
+        operator bool() const { return success_; }
+
+        bool operator!() const { return !success_; }
+
+        Token &operator*() { return token_; }
+
+        Error get_error() const { return err_; }
+    };
+
+    /// True if the `size' bytes at `p' are ASCII and few enough to
+    /// check inline, with at most two overlapping loads, rather than
+    /// with a Utf8ValidateFn.  Most strings are short keys.
+    inline bool short_ascii(const char *p, std::size_t size) {
+        std::uint64_t a = 0;
+        std::uint64_t b = 0;
+        if (size > 16) {
+            return false;
+        } else if (size >= 8) {
+            std::memcpy(&a, p, 8);
+            std::memcpy(&b, p + size - 8, 8);
+        } else if (size >= 4) {
+            std::uint32_t lo;
+            std::uint32_t hi;
+            std::memcpy(&lo, p, 4);
+            std::memcpy(&hi, p + size - 4, 4);
+            a = lo;
+            b = hi;
+        } else {
+            for (std::size_t i = 0; i < size; ++i) {
+                a |= static_cast<unsigned char>(p[i]);
+            }
+        }
+        return ((a | b) & 0x8080808080808080) == 0;
+    }
+
+    class Lexer {
+        const char *begin_;
+        const char *cur_;
+        const char *end_;
+        // False if more input may follow end_.
+        bool final_;
+        const char *token_start_;
+
+        // Structural bits of the block starting at begin_ + block_pos_
+        // that have not been consumed yet.
+        std::size_t block_pos_ = 0;
+        std::uint64_t bits_ = 0;
+        bool started_ = false;
+        detail::ClassifyFn classify_;
+        detail::StringSpecialFn find_string_special_;
+        detail::Utf8ValidateFn validate_utf8_;
+        std::string scratch_;
+        detail::StructuralScanner scanner_;
+        // Why and where the last token failed.
+        ParseErrorCode error_ = ParseErrorCode::NONE;
+        const char *error_at_ = nullptr;
+        // See stats.h; null unless parse() was given a ParseStats.
+        detail::StatsRecorder *stats_ = nullptr;
+
+        bool fail(ParseErrorCode code, const char *at) {
+            error_ = code;
+            error_at_ = at;
+            return false;
+        }
+
+        static bool is_digit(char c) { return '0' <= c && c <= '9'; }
+
+        static bool is_space(char c) {
+            return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+        }
+
+        static bool is_op(char c) {
+            return c == '{' || c == '}' || c == '[' || c == ']' ||
+                   c == ':' || c == ',';
+        }
+
+        void scan_block() {
+            const char *block = begin_ + block_pos_;
+            detail::BlockMasks masks;
+            if (static_cast<std::size_t>(end_ - block) >=
+                detail::SCAN_BLOCK_SIZE) {
+                classify_(block, &masks);
+            } else {
+                // Pad the tail with whitespace, which never produces a
+                // structural bit.
+                char tail[detail::SCAN_BLOCK_SIZE];
+                std::memset(tail, ' ', sizeof(tail));
+                std::memcpy(tail, block, end_ - block);
+                classify_(tail, &masks);
+            }
+            bits_ = scanner_.next(masks);
+        }
+
+        /// Returns the next position that starts a token, or end_.
+        const char *next_structural() {
+            for (;;) {
+                while (bits_ == 0) {
+                    if (started_) {
+                        block_pos_ += detail::SCAN_BLOCK_SIZE;
+                    }
+                    started_ = true;
+                    if (block_pos_ >=
+                        static_cast<std::size_t>(end_ - begin_)) {
+                        return end_;
+                    }
+                    scan_block();
+                }
+
+                const char *pos =
+                    begin_ + block_pos_ + std::countr_zero(bits_);
+                bits_ &= bits_ - 1;
+                // Bits behind the cursor belong to a token that has
+                // already been consumed (only possible after an error).
+                if (pos >= cur_) {
+                    return pos;
+                }
+            }
+        }
+
+        /// A number or literal must be followed by whitespace, an
+        /// operator or the end of input.  The structural index has no
+        /// bit for the bytes that follow it, so this has to be checked
+        /// here rather than by the next call to next().
+        bool at_scalar_end() const {
+            return cur_ == end_ || is_space(*cur_) || is_op(*cur_);
+        }
+
+        static int hex_value(char c) {
+            if ('0' <= c && c <= '9') {
+                return c - '0';
+            } else if ('a' <= c && c <= 'f') {
+                return c - 'a' + 10;
+            } else if ('A' <= c && c <= 'F') {
+                return c - 'A' + 10;
+            }
+            return -1;
+        }
+
+        /// Reads the four hex digits of a \u escape.
+        static bool parse_hex4(const char *p, std::uint32_t *codepoint) {
+            *codepoint = 0;
+            for (int i = 0; i < 4; ++i) {
+                int val = hex_value(p[i]);
+                if (val < 0) {
+                    return false;
+                }
+                *codepoint = (*codepoint << 4) | val;
+            }
+            return true;
+        }
+
+        static void append_utf8(std::string *out, std::uint32_t codepoint) {
+            if (codepoint > 0xffff) {
+                out->push_back(0xf0 | ((codepoint >> 18) & 0x07));
+                out->push_back(0x80 | ((codepoint >> 12) & 0x3f));
+                out->push_back(0x80 | ((codepoint >> 6) & 0x3f));
+                out->push_back(0x80 | ((codepoint >> 0) & 0x3f));
+            } else if (codepoint > 0x7ff) {
+                out->push_back(0xe0 | ((codepoint >> 12) & 0x0f));
+                out->push_back(0x80 | ((codepoint >> 6) & 0x3f));
+                out->push_back(0x80 | ((codepoint >> 0) & 0x3f));
+            } else if (codepoint > 0x7f) {
+                out->push_back(0xc0 | ((codepoint >> 6) & 0x1f));
+                out->push_back(0x80 | ((codepoint >> 0) & 0x3f));
+            } else {
+                out->push_back(codepoint);
+            }
+        }
+
+        /// Decodes one escape sequence starting at the backslash `p'
+        /// into `out'.  Returns the position after the sequence, or
+        /// nullptr if it is malformed.
+        const char *unescape(const char *p, std::string *out) {
+            if (end_ - p < 2) {
+                fail(ParseErrorCode::UNEXPECTED_END, end_);
+                return nullptr;
+            }
+
+            switch (p[1]) {
+            case '"':
+                out->push_back('"');
+                break;
+            case '\\':
+                out->push_back('\\');
+                break;
+            case '/':
+                out->push_back('/');
+                break;
+            case 'b':
+                out->push_back('\b');
+                break;
+            case 'f':
+                out->push_back('\f');
+                break;
+            case 'n':
+                out->push_back('\n');
+                break;
+            case 'r':
+                out->push_back('\r');
+                break;
+            case 't':
+                out->push_back('\t');
+                break;
+            case 'u': {
+                if (end_ - p < 6) {
+                    fail(ParseErrorCode::UNEXPECTED_END, end_);
+                    return nullptr;
+                }
+                std::uint32_t codepoint;
+                if (!parse_hex4(p + 2, &codepoint)) {
+                    fail(ParseErrorCode::INVALID_ESCAPE, p);
+                    return nullptr;
+                }
+                const char *next = p + 6;
+                if (codepoint >= 0xdc00 && codepoint <= 0xdfff) {
+                    // A low surrogate without the high one.
+                    if (JSON_STRICT_UTF8) {
+                        fail(ParseErrorCode::INVALID_ESCAPE, p);
+                        return nullptr;
+                    }
+                } else if (codepoint >= 0xd800 && codepoint <= 0xdbff) {
+                    // A high surrogate and the escape of a low one that
+                    // follows it stand for one code point beyond the BMP.
+                    std::uint32_t low;
+                    if (end_ - next >= 6 && next[0] == '\\' &&
+                        next[1] == 'u' && parse_hex4(next + 2, &low) &&
+                        low >= 0xdc00 && low <= 0xdfff) {
+                        codepoint =
+                            0x10000 + ((codepoint - 0xd800) << 10) +
+                            (low - 0xdc00);
+                        next += 6;
+                    } else if (JSON_STRICT_UTF8) {
+                        // The low one may just be cut off.
+                        bool cut = end_ - next < 6 &&
+                                   (next == end_ || next[0] == '\\') &&
+                                   (end_ - next < 2 || next[1] == 'u');
+                        if (cut) {
+                            fail(ParseErrorCode::UNEXPECTED_END, end_);
+                        } else {
+                            fail(ParseErrorCode::INVALID_ESCAPE, p);
+                        }
+                        return nullptr;
+                    }
+                }
+                append_utf8(out, codepoint);
+                return next;
+            }
+            default:
+                fail(ParseErrorCode::INVALID_ESCAPE, p);
+                return nullptr;
+            }
+            return p + 2;
+        }
+
+        /// Scans a string whose opening quote has just been consumed and
+        /// stores its unescaped contents in `value'.  Runs without
+        /// escapes are located with find_string_special() and copied in
+        /// one piece; a string without any escapes is not copied at all
+        /// and `value' points into the input.  Otherwise `value' points
+        /// into scratch_, which stays valid until the next call.  With
+        /// JSON_STRICT_UTF8, the raw string must be valid UTF-8; escapes
+        /// are ASCII, so it can be checked in one piece once its end has
+        /// been found.
+        bool tokenize_string(std::string_view *value) {
+            const char *start = cur_;
+            const char *run = cur_;
+            const char *p = cur_;
+            bool copied = false;
+            for (;;) {
+                p += find_string_special_(p, end_);
+                if (p == end_) {
+                    cur_ = end_;
+                    return fail(ParseErrorCode::UNEXPECTED_END, end_);
+                }
+
+                if (*p == '"') {
+                    break;
+                } else if (*p != '\\') {
+                    // Unescaped control character.
+                    return fail(ParseErrorCode::CONTROL_CHARACTER, p);
+                }
+
+                if (!copied) {
+                    scratch_.clear();
+                    copied = true;
+                    if (stats_on(stats_)) {
+                        ++stats_->stats->escaped_strings;
+                    }
+                }
+                stats_track(stats_, scratch_, [&] {
+                    scratch_.append(run, p);
+                    p = unescape(p, &scratch_);
+                });
+                if (p == nullptr) {
+                    // The escape may just be cut off.
+                    if (error_ == ParseErrorCode::UNEXPECTED_END) {
+                        cur_ = end_;
+                    }
+                    return false;
+                }
+                run = p;
+            }
+
+            if (JSON_STRICT_UTF8 &&
+                !short_ascii(start, static_cast<std::size_t>(p - start))) {
+                std::size_t valid = validate_utf8_(start, p);
+                if (start + valid != p) {
+                    return fail(ParseErrorCode::INVALID_UTF8, start + valid);
+                }
+            }
+
+            if (copied) {
+                stats_track(stats_, scratch_,
+                            [&] { scratch_.append(run, p); });
+                *value = scratch_;
+            } else {
+                *value = std::string_view(run, p - run);
+            }
+            cur_ = p + 1;
+            return true;
+        }
+
+        /// Accumulates one digit into the significand.  Digits beyond
+        /// MAX_EXACT_DIGITS are dropped and only tracked through the
+        /// exponent and `truncated'.
+        static void add_digit(char c, bool fraction, std::uint64_t *mantissa,
+                              int *digits, std::int64_t *exponent,
+                              bool *truncated) {
+            if (*digits < detail::MAX_EXACT_DIGITS) {
+                *mantissa = *mantissa * 10 + (c - '0');
+                if (*mantissa != 0) {
+                    ++*digits;
+                }
+                if (fraction) {
+                    --*exponent;
+                }
+            } else {
+                if (c != '0') {
+                    *truncated = true;
+                }
+                if (!fraction) {
+                    ++*exponent;
+                }
+            }
+        }
+
+        /// Validates a number whose first character has just been
+        /// consumed and converts it in the same pass.  Integers that fit
+        /// are kept exact; everything else becomes the nearest double.
+        /// Returns false on a syntax error or if the value is too large
+        /// (or too small) to be represented as a double.
+        bool tokenize_number(std::string_view *token, JSON_Number *number) {
+            const char *start = cur_ - 1;
+            bool negative = *start == '-';
+            const char *int_begin = negative ? cur_ : start;
+
+            if (negative) {
+                if (cur_ == end_ || !is_digit(*cur_)) {
+                    return fail(ParseErrorCode::INVALID_NUMBER, start);
+                }
+                ++cur_;
+            }
+
+            std::uint64_t mantissa = 0;
+            int digits = 0;
+            std::int64_t exponent = 0;
+            bool truncated = false;
+
+            add_digit(*int_begin, false, &mantissa, &digits, &exponent,
+                      &truncated);
+            if (*int_begin != '0') {
+                while (cur_ != end_ && is_digit(*cur_)) {
+                    add_digit(*cur_++, false, &mantissa, &digits, &exponent,
+                              &truncated);
+                }
+            }
+            const char *int_end = cur_;
+            bool integer = true;
+
+            if (cur_ != end_ && *cur_ == '.') {
+                integer = false;
+                ++cur_;
+                if (cur_ == end_ || !is_digit(*cur_)) {
+                    return fail(ParseErrorCode::INVALID_NUMBER, start);
+                }
+                while (cur_ != end_ && is_digit(*cur_)) {
+                    add_digit(*cur_++, true, &mantissa, &digits, &exponent,
+                              &truncated);
+                }
+            }
+
+            if (cur_ != end_ && (*cur_ == 'E' || *cur_ == 'e')) {
+                integer = false;
+                ++cur_;
+                bool negative_exponent = false;
+                if (cur_ != end_ && (*cur_ == '+' || *cur_ == '-')) {
+                    negative_exponent = *cur_ == '-';
+                    ++cur_;
+                }
+                if (cur_ == end_ || !is_digit(*cur_)) {
+                    return fail(ParseErrorCode::INVALID_NUMBER, start);
+                }
+                // Saturate; anything this large is out of range anyway.
+                std::int64_t explicit_exponent = 0;
+                while (cur_ != end_ && is_digit(*cur_)) {
+                    if (explicit_exponent < 100000) {
+                        explicit_exponent =
+                            explicit_exponent * 10 + (*cur_ - '0');
+                    }
+                    ++cur_;
+                }
+                exponent += negative_exponent ? -explicit_exponent
+                                              : explicit_exponent;
+            }
+
+            *token = std::string_view(start, cur_ - start);
+
+            if (integer && int_end - int_begin <= 20) {
+                std::uint64_t value = mantissa;
+                bool fits = true;
+                if (int_end - int_begin == 20) {
+                    // The last digit was dropped by add_digit().
+                    fits = !__builtin_mul_overflow(mantissa, 10, &value) &&
+                           !__builtin_add_overflow(value, int_end[-1] - '0',
+                                                   &value);
+                }
+
+                constexpr std::uint64_t int64_max =
+                    std::numeric_limits<std::int64_t>::max();
+                if (fits && !negative) {
+                    *number = value <= int64_max
+                                  ? JSON_Number(std::int64_t(value))
+                                  : JSON_Number(value);
+                    return true;
+                } else if (fits && value != 0 && value <= int64_max + 1) {
+                    // -0 stays a double so that its sign survives.
+                    *number = JSON_Number(static_cast<std::int64_t>(-value));
+                    return true;
+                }
+            }
+
+            double value;
+            if (truncated ||
+                !detail::decimal_to_double(negative, mantissa, exponent,
+                                           &value)) {
+                // Hard case: let the standard library do an exact
+                // conversion.
+                auto [ptr, ec] = std::from_chars(start, cur_, value);
+                if (ec == std::errc::result_out_of_range) {
+                    return fail(ParseErrorCode::NUMBER_OUT_OF_RANGE, start);
+                } else if (ec != std::errc() || ptr != cur_) {
+                    return fail(ParseErrorCode::INVALID_NUMBER, start);
+                }
+            }
+
+            if (std::isinf(value) || (value == 0 && mantissa != 0)) {
+                return fail(ParseErrorCode::NUMBER_OUT_OF_RANGE, start);
+            }
+            *number = JSON_Number(value);
+            return true;
+        }
+
+        bool check_token(const char *expected) {
+            // The first character has already been consumed by next().
+            std::size_t rest = std::strlen(expected) - 1;
+            std::size_t available =
+                std::min(rest, static_cast<std::size_t>(end_ - cur_));
+            if (std::memcmp(cur_, expected + 1, available) != 0) {
+                return fail(ParseErrorCode::INVALID_LITERAL, token_start_);
+            }
+            // A cut-off prefix leaves the cursor at the end.
+            cur_ += available;
+            if (available != rest) {
+                return fail(ParseErrorCode::UNEXPECTED_END, end_);
+            }
+            return true;
+        }
+
+        /// The error for a token that failed with the cursor at `cur_'.
+        TokenResult::Error failure() const {
+            return !final_ && cur_ == end_ ? TokenResult::Error::INCOMPLETE
+                                           : TokenResult::Error::SYNTAX;
+        }
+
+        /// A scalar that ends exactly at the end of a non-final buffer
+        /// might continue in the next one.
+        bool scalar_complete() const { return final_ || cur_ != end_; }
+
+    public:
+        /// With `final' false, `input' is a prefix of the text and
+        /// tokens that might continue past it yield INCOMPLETE.
+        explicit Lexer(std::string_view input, bool final = true)
+            : begin_(input.data()), cur_(input.data()),
+              end_(input.data() + input.size()), final_(final),
+              token_start_(input.data()),
+              classify_(detail::select_kernels().classify),
+              find_string_special_(
+                  detail::select_kernels().find_string_special),
+              validate_utf8_(detail::select_kernels().validate_utf8) {}
+
+        /// Starts over on `input' as a new Lexer would, but keeps the
+        /// buffer that escaped strings are decoded into.
+        void reset(std::string_view input, bool final = true) {
+            std::string scratch = std::move(scratch_);
+            *this = Lexer(input, final);
+            scratch_ = std::move(scratch);
+        }
+
+        /// Bytes held by the decoding buffer.
+        std::size_t scratch_bytes() const { return scratch_.capacity(); }
+
+        /// Frees the decoding buffer.
+        void release_scratch() { std::string().swap(scratch_); }
+
+        /// Counts escaped strings and the growth of the decoding buffer
+        /// in `stats', which may be null.
+        void set_stats(detail::StatsRecorder *stats) { stats_ = stats; }
+
+        /// Where the token last returned by next(), or the failed one,
+        /// starts.
+        const char *token_start() const { return token_start_; }
+
+        /// Where lexing continues, i.e. just past the last token.
+        const char *position() const { return cur_; }
+
+        /// Why the last token failed with SYNTAX, and the byte at fault.
+        ParseErrorCode error() const { return error_; }
+        const char *error_position() const { return error_at_; }
+
+        TokenResult next() {
+            // Everything between the cursor and the next structural
+            // position is whitespace.
+            cur_ = next_structural();
+            token_start_ = cur_;
+            if (cur_ == end_) {
+                return TokenResult::Error::END;
+            }
+
+            char c = *cur_++;
+            std::string_view token(cur_ - 1, 1);
+
+            switch (c) {
+            case '[':
+                return Token(TokenType::ARRAY_OPEN, token);
+            case ']':
+                return Token(TokenType::ARRAY_CLOSE, token);
+            case '{':
+                return Token(TokenType::OBJ_OPEN, token);
+            case '}':
+                return Token(TokenType::OBJ_CLOSE, token);
+            case ':':
+                return Token(TokenType::COLON, token);
+            case ',':
+                return Token(TokenType::COMMA, token);
+            case '"':
+                if (!tokenize_string(&token)) {
+                    return failure();
+                }
+                return Token(TokenType::STRING, token);
+            case '-':
+            case '0':
+            case '1':
+            case '2':
+            case '3':
+            case '4':
+            case '5':
+            case '6':
+            case '7':
+            case '8':
+            case '9':
+            {
+                JSON_Number number(0.0);
+                if (!tokenize_number(&token, &number)) {
+                    return failure();
+                }
+                if (!scalar_complete()) {
+                    return TokenResult::Error::INCOMPLETE;
+                }
+                if (!at_scalar_end()) {
+                    fail(ParseErrorCode::INVALID_NUMBER, token_start_);
+                    return TokenResult::Error::SYNTAX;
+                }
+                return Token(token, number);
+            }
+            case 't':
+                if (!check_token("true")) {
+                    return failure();
+                }
+                if (!scalar_complete()) {
+                    return TokenResult::Error::INCOMPLETE;
+                }
+                if (!at_scalar_end()) {
+                    fail(ParseErrorCode::INVALID_LITERAL, token_start_);
+                    return TokenResult::Error::SYNTAX;
+                }
+                return Token(TokenType::TRUE, "true");
+            case 'f':
+                if (!check_token("false")) {
+                    return failure();
+                }
+                if (!scalar_complete()) {
+                    return TokenResult::Error::INCOMPLETE;
+                }
+                if (!at_scalar_end()) {
+                    fail(ParseErrorCode::INVALID_LITERAL, token_start_);
+                    return TokenResult::Error::SYNTAX;
+                }
+                return Token(TokenType::FALSE, "false");
+            case 'n':
+                if (!check_token("null")) {
+                    return failure();
+                }
+                if (!scalar_complete()) {
+                    return TokenResult::Error::INCOMPLETE;
+                }
+                if (!at_scalar_end()) {
+                    fail(ParseErrorCode::INVALID_LITERAL, token_start_);
+                    return TokenResult::Error::SYNTAX;
+                }
+                return Token(TokenType::NULL_OBJ, "null");
+            default:
+                fail(ParseErrorCode::UNEXPECTED_CHARACTER, token_start_);
+                return TokenResult::Error::SYNTAX;
+            }
+        }
+    };
+
+    /// Turns byte offsets into lines and columns for input that is seen
+    /// in order, possibly in pieces, counting every newline once.
+    class LineCounter {
+        std::size_t offset_ = 0;
+        std::size_t line_ = 1;
+        std::size_t line_start_ = 0;
+
+    public:
+        /// Where the next byte passed to advance() is in the input.
+        std::size_t offset() const { return offset_; }
+
+        /// Counts `text', which continues the input at offset().
+        void advance(std::string_view text) {
+            const char *p = text.data();
+            const char *end = p + text.size();
+            while ((p = static_cast<const char *>(
+                        std::memchr(p, '\n', end - p))) != nullptr) {
+                ++line_;
+                ++p;
+                line_start_ = offset_ + (p - text.data());
+            }
+            offset_ += text.size();
+        }
+
+        /// Sets the position of `error' to offset().
+        void locate(ParseError *error) const {
+            error->offset = offset_;
+            error->line = line_;
+            error->column = offset_ - line_start_ + 1;
+        }
+    };
+
+    /// A handler that accepts every event, for checking input without
+    /// keeping anything.
+    struct NullHandler {
+        bool start_object() { return true; }
+        bool key(std::string_view) { return true; }
+        bool end_object() { return true; }
+        bool start_array() { return true; }
+        bool end_array() { return true; }
+        template <typename T> bool value(T) { return true; }
+    };
+
+    /// The JSON grammar as a state machine over tokens, with the open
+    /// containers on an explicit stack so that it can be suspended
+    /// between any two tokens.  It drives a handler as described in
+    /// sax.h.
+    template <typename Handler>
+    class Grammar {
+        enum class State {
+            VALUE,
+            FIRST_ELEMENT, // VALUE, or ']' right after '['
+            FIRST_MEMBER,  // key, or '}' right after '{'
+            KEY,
+            COLON,
+            AFTER_VALUE,   // ',' or the closing bracket
+            DONE,
+        };
+
+        Handler &handler_;
+        int max_depth_;
+        State state_ = State::VALUE;
+        // True for objects, false for arrays.
+        std::vector<bool> open_;
+        ParseErrorCode error_ = ParseErrorCode::NONE;
+        // See stats.h; null unless parse() was given a ParseStats.
+        detail::StatsRecorder *stats_ = nullptr;
+
+        bool fail(ParseErrorCode code) {
+            error_ = code;
+            return false;
+        }
+
+        bool after_value() {
+            state_ = open_.empty() ? State::DONE : State::AFTER_VALUE;
+            return true;
+        }
+
+        /// A container is entered with one less unit of depth than its
+        /// parent and may not be entered with none left, so there can
+        /// be at most max_depth - 1 levels of nesting.
+        bool open(bool object) {
+            if (max_depth_ <= static_cast<int>(open_.size()) + 1) {
+                return fail(ParseErrorCode::TOO_DEEP);
+            }
+            stats_track(stats_, open_, [&] { open_.push_back(object); });
+            if (stats_on(stats_)) {
+                stats_->stats->max_depth =
+                    std::max(stats_->stats->max_depth,
+                             static_cast<int>(open_.size()));
+            }
+            if (object) {
+                state_ = State::FIRST_MEMBER;
+                return handler_.start_object();
+            }
+            state_ = State::FIRST_ELEMENT;
+            return handler_.start_array();
+        }
+
+        bool close(bool object) {
+            if (open_.back() != object) {
+                return fail(ParseErrorCode::UNEXPECTED_TOKEN);
+            }
+            open_.pop_back();
+            after_value();
+            return object ? handler_.end_object() : handler_.end_array();
+        }
+
+        bool value(Token &token) {
+            switch (token.get_type()) {
+            case TokenType::TRUE:
+            case TokenType::FALSE:
+                return after_value() &&
+                       handler_.value(token.parse_boolean());
+            case TokenType::NULL_OBJ:
+                return after_value() && handler_.value(nullptr);
+            case TokenType::NUMBER: {
+                after_value();
+                const JSON_Number &number = token.parse_number();
+                switch (number.get_kind()) {
+                case JSON_Number::Kind::INT64:
+                    return handler_.value(number.get_int64());
+                case JSON_Number::Kind::UINT64:
+                    return handler_.value(number.get_uint64());
+                default:
+                    return handler_.value(number.get_value());
+                }
+            }
+            case TokenType::STRING:
+                return after_value() && handler_.value(token.get_token());
+            case TokenType::ARRAY_OPEN:
+                return open(false);
+            case TokenType::OBJ_OPEN:
+                return open(true);
+            default:
+                return fail(ParseErrorCode::UNEXPECTED_TOKEN);
+            }
+        }
+
+    public:
+        /// max_depth has the meaning documented for json::parse();
+        /// negative values are taken as 0, which admits no containers.
+        Grammar(Handler &handler, int max_depth)
+            : handler_(handler), max_depth_(std::max(max_depth, 0)) {}
+
+        /// Counts the depth reached and the growth of the stack of open
+        /// containers in `stats', which may be null.
+        void set_stats(detail::StatsRecorder *stats) { stats_ = stats; }
+
+        /// Consumes one token.  Returns false on a syntax error or if
+        /// the handler aborts, after which the Grammar must not be used
+        /// again.
+        bool next(Token &token) {
+            TokenType type = token.get_type();
+            switch (state_) {
+            case State::FIRST_ELEMENT:
+                if (type == TokenType::ARRAY_CLOSE) {
+                    return close(false);
+                }
+                return value(token);
+            case State::VALUE:
+                return value(token);
+            case State::FIRST_MEMBER:
+                if (type == TokenType::OBJ_CLOSE) {
+                    return close(true);
+                }
+                [[fallthrough]];
+            case State::KEY:
+                if (type != TokenType::STRING) {
+                    return fail(ParseErrorCode::UNEXPECTED_TOKEN);
+                }
+                state_ = State::COLON;
+                return handler_.key(token.get_token());
+            case State::COLON:
+                if (type != TokenType::COLON) {
+                    return fail(ParseErrorCode::UNEXPECTED_TOKEN);
+                }
+                state_ = State::VALUE;
+                return true;
+            case State::AFTER_VALUE:
+                if (type == TokenType::COMMA) {
+                    state_ = open_.back() ? State::KEY : State::VALUE;
+                    return true;
+                } else if (type == TokenType::ARRAY_CLOSE) {
+                    return close(false);
+                } else if (type == TokenType::OBJ_CLOSE) {
+                    return close(true);
+                }
+                return fail(ParseErrorCode::UNEXPECTED_TOKEN);
+            default:
+                // Nothing may follow the root value.
+                return fail(ParseErrorCode::TRAILING_CONTENT);
+            }
+        }
+
+        /// True once a complete root value has been consumed.
+        bool done() const { return state_ == State::DONE; }
+
+        /// True once any token has been consumed.
+        bool started() const {
+            return state_ != State::VALUE || !open_.empty();
+        }
+
+        /// Makes the Grammar ready for another root value, also after a
+        /// failed next().
+        void reset() {
+            state_ = State::VALUE;
+            open_.clear();
+            error_ = ParseErrorCode::NONE;
+        }
+
+        /// reset(), and applies `max_depth' from now on.
+        void reset(int max_depth) {
+            reset();
+            max_depth_ = std::max(max_depth, 0);
+        }
+
+        /// Bytes held by the stack of open containers.
+        std::size_t scratch_bytes() const { return open_.capacity() / 8; }
+
+        /// Frees the stack of open containers.
+        void release_scratch() { std::vector<bool>().swap(open_); }
+
+        /// Why next() returned false.  A failure that the Grammar did not
+        /// cause came from the handler.
+        ParseErrorCode error() const {
+            return error_ == ParseErrorCode::NONE
+                       ? ParseErrorCode::HANDLER_ABORTED
+                       : error_;
+        }
+    };
+
+    /// The error a Lexer and Grammar loop over `input' stopped with:
+    /// `failure' from the lexer, or a token the grammar rejected if
+    /// `failure' is null.  `lines' is at the start of `input'.  Tokens
+    /// may stand for a Lexer or anything with the same accessors.
+    template <typename Tokens, typename Handler>
+    ParseError describe_failure(std::string_view input, const Tokens &lexer,
+                                const Grammar<Handler> &grammar,
+                                const TokenResult *failure,
+                                LineCounter lines = LineCounter()) {
+        ParseError error;
+        const char *at;
+        if (failure == nullptr) {
+            error.code = grammar.error();
+            at = lexer.token_start();
+        } else if (failure->get_error() == TokenResult::Error::END) {
+            error.code = grammar.started() ? ParseErrorCode::UNEXPECTED_END
+                                           : ParseErrorCode::EMPTY_INPUT;
+            at = lexer.position();
+        } else {
+            error.code = lexer.error();
+            at = lexer.error_position();
+        }
+        lines.advance(input.substr(0, at - input.data()));
+        lines.locate(&error);
+        return error;
+    }
+
+    /// Drives `grammar' with the tokens of `lexer', which must be fresh
+    /// or reset() on `input', to the end of the input; see parse_sax().
+    /// As for describe_failure(), `lexer' may be a stand-in.
+    template <typename Tokens, typename Handler>
+    bool parse_document(std::string_view input, Tokens &lexer,
+                        Grammar<Handler> &grammar, ParseError *error) {
+        for (;;) {
+            TokenResult tk = lexer.next();
+            if (!tk) {
+                if (tk.get_error() == TokenResult::Error::END &&
+                    grammar.done()) {
+                    return true;
+                }
+                if (error != nullptr) {
+                    *error = describe_failure(input, lexer, grammar, &tk);
+                }
+                return false;
+            }
+            if (!grammar.next(*tk)) {
+                if (error != nullptr) {
+                    *error = describe_failure(input, lexer, grammar, nullptr);
+                }
+                return false;
+            }
+        }
+    }
+} // namespace json::detail
+
+namespace json {
+    /// Parses exactly one value followed by the end of input, reporting it
+    /// to `handler'.  Returns false on a syntax error, if the document is
+    /// nested too deeply (see parse()) or if the handler aborts; the handler
+    /// may have seen events for a prefix of the input by then.  The reason
+    /// is stored in `*error' if it is given.
+    template <typename Handler>
+    bool parse_sax(std::string_view input, Handler &handler,
+                   int max_depth = 64, ParseError *error = nullptr) {
+        detail::Lexer lexer(input);
+        detail::Grammar<Handler> grammar(handler, max_depth);
+        return detail::parse_document(input, lexer, grammar, error);
+    }
+
+    /// The push counterpart of parse_sax(): input is fed in chunks of any
+    /// size and every complete token is reported as soon as it has been
+    /// fed.  Only a token cut off at the end of the input seen so far is
+    /// buffered.
+    template <typename Handler>
+    class SaxPushParser {
+        detail::Grammar<Handler> grammar_;
+        // Input from the start of the first token that has not been
+        // consumed yet.
+        std::string pending_;
+        // An incomplete token is only lexed again once pending_ has doubled
+        // in size, so that a long token fed in many small pieces is not
+        // rescanned from its start for every piece.
+        std::size_t retry_size_ = 0;
+        bool failed_ = false;
+        bool finished_ = false;
+        // Positioned at the start of pending_.
+        detail::LineCounter lines_;
+        ParseError error_;
+
+        /// Feeds every complete token in pending_ to the grammar.
+        bool drain(bool final) {
+            detail::Lexer lexer(pending_, final);
+            for (;;) {
+                detail::TokenResult tk = lexer.next();
+                if (tk) {
+                    if (!grammar_.next(*tk)) {
+                        error_ = detail::describe_failure(
+                            pending_, lexer, grammar_, nullptr, lines_);
+                        return false;
+                    }
+                } else if (tk.get_error() ==
+                           detail::TokenResult::Error::END) {
+                    lines_.advance(pending_);
+                    pending_.clear();
+                    retry_size_ = 0;
+                    return true;
+                } else if (tk.get_error() ==
+                           detail::TokenResult::Error::INCOMPLETE) {
+                    std::size_t consumed =
+                        lexer.token_start() - pending_.data();
+                    lines_.advance(
+                        std::string_view(pending_).substr(0, consumed));
+                    pending_.erase(0, consumed);
+                    retry_size_ = 2 * pending_.size();
+                    return true;
+                } else {
+                    error_ = detail::describe_failure(pending_, lexer, grammar_,
+                                                      &tk, lines_);
+                    return false;
+                }
+            }
+        }
+
+    public:
+        /// `handler' must outlive the parser.
+        explicit SaxPushParser(Handler &handler, int max_depth = 64)
+            : grammar_(handler, max_depth) {}
+
+        /// Returns false once the input seen so far cannot be the start of
+        /// a document, or the handler has aborted; later calls do nothing.
+        bool feed(const char *data, std::size_t size) {
+            if (failed_ || finished_) {
+                return false;
+            }
+            pending_.append(data, size);
+            if (pending_.size() >= retry_size_) {
+                failed_ = !drain(false);
+            }
+            return !failed_;
+        }
+
+        /// Ends the input.  Returns true if the whole input was exactly one
+        /// document.  The parser cannot be fed again.
+        bool finish() {
+            if (finished_) {
+                return false;
+            }
+            finished_ = true;
+            if (failed_ || !drain(true)) {
+                return false;
+            } else if (!grammar_.done()) {
+                error_.code = grammar_.started()
+                                  ? ParseErrorCode::UNEXPECTED_END
+                                  : ParseErrorCode::EMPTY_INPUT;
+                lines_.locate(&error_);
+                return false;
+            }
+            return true;
+        }
+
+        /// Why feed() or finish() returned false.  Offsets count from the
+        /// start of everything fed.
+        const ParseError &error() const { return error_; }
+    };
+} // namespace json
+
+#endif
@@ -0,0 +1,548 @@
+#include <bit>
+#include <cstring>
+
+#include "scan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define JSON_SCAN_X86 1
+#endif
+
+namespace json::detail {
+    namespace {
+        void classify_scalar(const char *block, BlockMasks *masks) {
+            *masks = {};
+            for (std::size_t i = 0; i < SCAN_BLOCK_SIZE; ++i) {
+                std::uint64_t bit = std::uint64_t(1) << i;
+                switch (block[i]) {
+                case ' ':
+                case '\n':
+                case '\r':
+                case '\t':
+                    masks->whitespace |= bit;
+                    break;
+                case '{':
+                case '}':
+                case '[':
+                case ']':
+                case ':':
+                case ',':
+                    masks->op |= bit;
+                    break;
+                case '"':
+                    masks->quote |= bit;
+                    break;
+                case '\\':
+                    masks->backslash |= bit;
+                    break;
+                }
+            }
+        }
+
+        bool is_string_special(char c) {
+            return c == '"' || c == '\\' ||
+                   static_cast<unsigned char>(c) < 0x20;
+        }
+
+        std::size_t find_string_special_scalar(const char *p,
+                                               const char *end) {
+            const char *start = p;
+            while (p != end && !is_string_special(*p)) {
+                ++p;
+            }
+            return p - start;
+        }
+
+        /// The length of the well-formed UTF-8 sequence at `i', whose
+        /// first byte is not ASCII, or 0 if there is none, after the table
+        /// of well-formed byte sequences in the Unicode standard (Table
+        /// 3-7).
+        std::ptrdiff_t sequence_length(const unsigned char *i,
+                                       const unsigned char *last) {
+            // The range of the second byte is narrowed after the leads
+            // that would otherwise allow overlong forms (E0, F0),
+            // surrogates (ED) or code points beyond U+10FFFF (F4).
+            unsigned char lead = *i;
+            std::ptrdiff_t length;
+            unsigned char low = 0x80;
+            unsigned char high = 0xbf;
+            if (0xc2 <= lead && lead <= 0xdf) {
+                length = 2;
+            } else if (0xe0 <= lead && lead <= 0xef) {
+                length = 3;
+                if (lead == 0xe0) {
+                    low = 0xa0;
+                } else if (lead == 0xed) {
+                    high = 0x9f;
+                }
+            } else if (0xf0 <= lead && lead <= 0xf4) {
+                length = 4;
+                if (lead == 0xf0) {
+                    low = 0x90;
+                } else if (lead == 0xf4) {
+                    high = 0x8f;
+                }
+            } else {
+                return 0;
+            }
+            if (last - i < length || i[1] < low || i[1] > high) {
+                return 0;
+            }
+            for (std::ptrdiff_t k = 2; k < length; ++k) {
+                if ((i[k] & 0xc0) != 0x80) {
+                    return 0;
+                }
+            }
+            return length;
+        }
+
+        /// Decodes sequence by sequence, skipping ASCII a word at a time.
+        std::size_t validate_utf8_scalar(const char *p, const char *end) {
+            const auto *begin = reinterpret_cast<const unsigned char *>(p);
+            const auto *last = reinterpret_cast<const unsigned char *>(end);
+            const unsigned char *i = begin;
+            while (i != last) {
+                std::uint64_t word;
+                if (last - i >= 8) {
+                    std::memcpy(&word, i, 8);
+                    if ((word & 0x8080808080808080) == 0) {
+                        i += 8;
+                        continue;
+                    }
+                }
+                if (*i < 0x80) {
+                    ++i;
+                    continue;
+                }
+                std::ptrdiff_t length = sequence_length(i, last);
+                if (length == 0) {
+                    return i - begin;
+                }
+                i += length;
+            }
+            return last - begin;
+        }
+
+#ifdef JSON_SCAN_X86
+        std::uint64_t movemask16(__m128i v, int shift) {
+            return static_cast<std::uint64_t>(
+                       static_cast<std::uint16_t>(_mm_movemask_epi8(v)))
+                   << shift;
+        }
+
+        void classify_sse2(const char *block, BlockMasks *masks) {
+            *masks = {};
+            for (int i = 0; i < 64; i += 16) {
+                __m128i in = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i *>(block + i));
+
+                __m128i ws = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(in, _mm_set1_epi8(' ')),
+                                 _mm_cmpeq_epi8(in, _mm_set1_epi8('\n'))),
+                    _mm_or_si128(_mm_cmpeq_epi8(in, _mm_set1_epi8('\r')),
+                                 _mm_cmpeq_epi8(in, _mm_set1_epi8('\t'))));
+
+                // '[' | 0x20 == '{' and ']' | 0x20 == '}', which saves two
+                // compares for the brackets.
+                __m128i lower = _mm_or_si128(in, _mm_set1_epi8(0x20));
+                __m128i op = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(lower, _mm_set1_epi8('{')),
+                                 _mm_cmpeq_epi8(lower, _mm_set1_epi8('}'))),
+                    _mm_or_si128(_mm_cmpeq_epi8(in, _mm_set1_epi8(':')),
+                                 _mm_cmpeq_epi8(in, _mm_set1_epi8(','))));
+
+                masks->whitespace |= movemask16(ws, i);
+                masks->op |= movemask16(op, i);
+                masks->quote |= movemask16(
+                    _mm_cmpeq_epi8(in, _mm_set1_epi8('"')), i);
+                masks->backslash |= movemask16(
+                    _mm_cmpeq_epi8(in, _mm_set1_epi8('\\')), i);
+            }
+        }
+
+        std::size_t find_string_special_sse2(const char *p, const char *end) {
+            const char *start = p;
+            const __m128i quote = _mm_set1_epi8('"');
+            const __m128i backslash = _mm_set1_epi8('\\');
+            const __m128i control_max = _mm_set1_epi8(0x1f);
+            for (; end - p >= 16; p += 16) {
+                __m128i in =
+                    _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                // max(c, 0x1f) == 0x1f iff c <= 0x1f (unsigned).
+                __m128i special = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(in, quote),
+                                 _mm_cmpeq_epi8(in, backslash)),
+                    _mm_cmpeq_epi8(_mm_max_epu8(in, control_max),
+                                   control_max));
+                int mask = _mm_movemask_epi8(special);
+                if (mask != 0) {
+                    return (p - start) + std::countr_zero(
+                                             static_cast<unsigned>(mask));
+                }
+            }
+            return (p - start) + find_string_special_scalar(p, end);
+        }
+
+        __attribute__((target("avx2"))) std::size_t
+        find_string_special_avx2(const char *p, const char *end) {
+            const char *start = p;
+            const __m256i quote = _mm256_set1_epi8('"');
+            const __m256i backslash = _mm256_set1_epi8('\\');
+            const __m256i control_max = _mm256_set1_epi8(0x1f);
+            for (; end - p >= 32; p += 32) {
+                __m256i in =
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+                __m256i special = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_cmpeq_epi8(in, quote),
+                                    _mm256_cmpeq_epi8(in, backslash)),
+                    _mm256_cmpeq_epi8(_mm256_max_epu8(in, control_max),
+                                      control_max));
+                unsigned mask =
+                    static_cast<unsigned>(_mm256_movemask_epi8(special));
+                if (mask != 0) {
+                    return (p - start) + std::countr_zero(mask);
+                }
+            }
+            return (p - start) + find_string_special_sse2(p, end);
+        }
+
+        /// Skips ASCII 16 bytes at a time and decodes the vectors that
+        /// are not ASCII sequence by sequence.  SSE2 has no byte shuffle
+        /// for the lookup tables of the AVX2 version.
+        std::size_t validate_utf8_sse2(const char *p, const char *end) {
+            const auto *begin = reinterpret_cast<const unsigned char *>(p);
+            const auto *last = reinterpret_cast<const unsigned char *>(end);
+            const unsigned char *i = begin;
+            while (last - i >= 16) {
+                __m128i in =
+                    _mm_loadu_si128(reinterpret_cast<const __m128i *>(i));
+                int mask = _mm_movemask_epi8(in);
+                if (mask == 0) {
+                    i += 16;
+                    continue;
+                }
+                const unsigned char *stop = i + 16;
+                i += std::countr_zero(static_cast<unsigned>(mask));
+                while (i < stop) {
+                    if (*i < 0x80) {
+                        ++i;
+                        continue;
+                    }
+                    std::ptrdiff_t length = sequence_length(i, last);
+                    if (length == 0) {
+                        return i - begin;
+                    }
+                    i += length;
+                }
+            }
+            return (i - begin) +
+                   validate_utf8_scalar(reinterpret_cast<const char *>(i),
+                                        end);
+        }
+
+        __attribute__((target("avx2"))) std::uint64_t
+        movemask32(__m256i v, int shift) {
+            return static_cast<std::uint64_t>(
+                       static_cast<std::uint32_t>(_mm256_movemask_epi8(v)))
+                   << shift;
+        }
+
+        __attribute__((target("avx2"))) void
+        classify_avx2(const char *block, BlockMasks *masks) {
+            *masks = {};
+            for (int i = 0; i < 64; i += 32) {
+                __m256i in = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i *>(block + i));
+
+                __m256i ws = _mm256_or_si256(
+                    _mm256_or_si256(
+                        _mm256_cmpeq_epi8(in, _mm256_set1_epi8(' ')),
+                        _mm256_cmpeq_epi8(in, _mm256_set1_epi8('\n'))),
+                    _mm256_or_si256(
+                        _mm256_cmpeq_epi8(in, _mm256_set1_epi8('\r')),
+                        _mm256_cmpeq_epi8(in, _mm256_set1_epi8('\t'))));
+
+                __m256i lower = _mm256_or_si256(in, _mm256_set1_epi8(0x20));
+                __m256i op = _mm256_or_si256(
+                    _mm256_or_si256(
+                        _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('{')),
+                        _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('}'))),
+                    _mm256_or_si256(
+                        _mm256_cmpeq_epi8(in, _mm256_set1_epi8(':')),
+                        _mm256_cmpeq_epi8(in, _mm256_set1_epi8(','))));
+
+                masks->whitespace |= movemask32(ws, i);
+                masks->op |= movemask32(op, i);
+                masks->quote |= movemask32(
+                    _mm256_cmpeq_epi8(in, _mm256_set1_epi8('"')), i);
+                masks->backslash |= movemask32(
+                    _mm256_cmpeq_epi8(in, _mm256_set1_epi8('\\')), i);
+            }
+        }
+
+        // Flags of the lookup tables of validate_utf8_avx2(), after Keiser
+        // and Lemire, "Validating UTF-8 In Less Than One Instruction Per
+        // Byte".  Each flag is a way in which a byte and the one before it
+        // can be wrong; three tables, indexed by the high and low nibble
+        // of the first byte and the high nibble of the second, each set
+        // the flags their nibble allows, and a pair is bad if a flag is
+        // set in all three.
+        namespace utf8 {
+            constexpr std::uint8_t TOO_SHORT = 1 << 0;  // lead, no cont.
+            constexpr std::uint8_t TOO_LONG = 1 << 1;   // ASCII, cont.
+            constexpr std::uint8_t OVERLONG_3 = 1 << 2; // E0 80..9F
+            constexpr std::uint8_t TOO_LARGE = 1 << 3;  // F4 90..BF, F5..
+            constexpr std::uint8_t SURROGATE = 1 << 4;  // ED A0..BF
+            constexpr std::uint8_t OVERLONG_2 = 1 << 5; // C0..C1
+            constexpr std::uint8_t TOO_LARGE_1000 = 1 << 6; // F5.. 80..8F
+            constexpr std::uint8_t OVERLONG_4 = 1 << 6; // F0 80..8F
+            // Two continuations in a row; only valid as the 2nd and 3rd,
+            // or 3rd and 4th, bytes of a sequence.
+            constexpr std::uint8_t TWO_CONTS = 1 << 7;
+            constexpr std::uint8_t CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+            constexpr std::uint8_t BYTE_1_HIGH[16] = {
+                TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+                TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+                TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+                TOO_SHORT | OVERLONG_2,
+                TOO_SHORT,
+                TOO_SHORT | OVERLONG_3 | SURROGATE,
+                TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4,
+            };
+
+            constexpr std::uint8_t BYTE_1_LOW[16] = {
+                CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+                CARRY | OVERLONG_2,
+                CARRY,
+                CARRY,
+                CARRY | TOO_LARGE,
+                CARRY | TOO_LARGE | TOO_LARGE_1000,
+                CARRY | TOO_LARGE | TOO_LARGE_1000,
+                CARRY | TOO_LARGE | TOO_LARGE_1000,
+                CARRY | TOO_LARGE | TOO_LARGE_1000,
+                CARRY | TOO_LARGE | TOO_LARGE_1000,
+                CARRY | TOO_LARGE | TOO_LARGE_1000,
+                CARRY | TOO_LARGE | TOO_LARGE_1000,
+                CARRY | TOO_LARGE | TOO_LARGE_1000,
+                CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+                CARRY | TOO_LARGE | TOO_LARGE_1000,
+                CARRY | TOO_LARGE | TOO_LARGE_1000,
+            };
+
+            constexpr std::uint8_t BYTE_2_HIGH[16] = {
+                TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+                TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+                TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 |
+                    TOO_LARGE_1000 | OVERLONG_4,
+                TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+                TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+                TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+                TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+            };
+        } // namespace utf8
+
+        __attribute__((target("avx2"))) __m256i
+        load_table(const std::uint8_t (&table)[16]) {
+            return _mm256_broadcastsi128_si256(
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(table)));
+        }
+
+        __attribute__((target("avx2"))) __m256i high_nibbles(__m256i v) {
+            return _mm256_and_si256(_mm256_srli_epi16(v, 4),
+                                    _mm256_set1_epi8(0x0f));
+        }
+
+        struct Utf8Check {
+            __m256i byte_1_high;
+            __m256i byte_1_low;
+            __m256i byte_2_high;
+            __m256i error;
+            // Flags the bytes of the last block checked that start a
+            // sequence that the block does not complete.
+            __m256i incomplete;
+        };
+
+        /// Adds the errors of the 32 bytes `in' to `check', given the 32
+        /// bytes `prev' that come before them.
+        __attribute__((target("avx2"))) void
+        check_utf8_block(__m256i in, __m256i prev, Utf8Check *check) {
+            if (_mm256_movemask_epi8(in) == 0) {
+                check->error = _mm256_or_si256(check->error, check->incomplete);
+                return;
+            }
+
+            // The input shifted by one, two and three bytes, with the end
+            // of the previous block shifted in.
+            __m256i carried = _mm256_permute2x128_si256(prev, in, 0x21);
+            __m256i prev1 = _mm256_alignr_epi8(in, carried, 15);
+            __m256i prev2 = _mm256_alignr_epi8(in, carried, 14);
+            __m256i prev3 = _mm256_alignr_epi8(in, carried, 13);
+
+            __m256i special = _mm256_and_si256(
+                _mm256_and_si256(
+                    _mm256_shuffle_epi8(check->byte_1_high,
+                                        high_nibbles(prev1)),
+                    _mm256_shuffle_epi8(
+                        check->byte_1_low,
+                        _mm256_and_si256(prev1, _mm256_set1_epi8(0x0f)))),
+                _mm256_shuffle_epi8(check->byte_2_high, high_nibbles(in)));
+
+            // A continuation after a continuation is right exactly where a
+            // 3 or 4 byte lead two or three bytes back asks for it, which
+            // flips TWO_CONTS.
+            __m256i must_continue = _mm256_or_si256(
+                _mm256_subs_epu8(prev2, _mm256_set1_epi8(0xe0 - 0x80)),
+                _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xf0 - 0x80)));
+            check->error = _mm256_or_si256(
+                check->error,
+                _mm256_xor_si256(
+                    _mm256_and_si256(must_continue,
+                                     _mm256_set1_epi8(static_cast<char>(0x80))),
+                    special));
+
+            // Leads of 4 bytes in the last three positions, of 3 in the
+            // last two and of 2 in the last need the next block.
+            const __m256i incomplete_max = _mm256_setr_epi8(
+                -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                static_cast<char>(0xf0 - 1), static_cast<char>(0xe0 - 1),
+                static_cast<char>(0xc0 - 1));
+            check->incomplete = _mm256_subs_epu8(in, incomplete_max);
+        }
+
+        /// Checks 32 bytes at a time with the lookup tables above.  Bytes
+        /// are judged against the three before them, so blocks carry over.
+        /// A partial last block is read as the last 32 bytes, overlapping
+        /// the block before, if there are that many; otherwise it is
+        /// padded with spaces.  Only whether there is an error is tracked,
+        /// so if there is one, the scalar code finds it.
+        __attribute__((target("avx2"))) std::size_t
+        validate_utf8_avx2(const char *p, const char *end) {
+            const char *start = p;
+            Utf8Check check = {load_table(utf8::BYTE_1_HIGH),
+                               load_table(utf8::BYTE_1_LOW),
+                               load_table(utf8::BYTE_2_HIGH),
+                               _mm256_setzero_si256(),
+                               _mm256_setzero_si256()};
+            __m256i prev = _mm256_setzero_si256();
+            for (; end - p >= 32; p += 32) {
+                __m256i in =
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+                check_utf8_block(in, prev, &check);
+                prev = in;
+            }
+
+            if (p != end && end - start >= 32) {
+                const char *last = end - 32;
+                // Only the three bytes before `last' matter in `prev'.
+                std::uint32_t context = 0;
+                for (int k = 1; k <= 3 && last - k >= start; ++k) {
+                    context |= std::uint32_t(
+                                   static_cast<unsigned char>(last[-k]))
+                               << (32 - 8 * k);
+                }
+                check_utf8_block(
+                    _mm256_loadu_si256(
+                        reinterpret_cast<const __m256i *>(last)),
+                    _mm256_set_epi32(static_cast<int>(context), 0, 0, 0, 0,
+                                     0, 0, 0),
+                    &check);
+            } else if (p != end) {
+                char tail[32];
+                std::memset(tail, ' ', sizeof(tail));
+                std::memcpy(tail, p, end - p);
+                check_utf8_block(
+                    _mm256_loadu_si256(
+                        reinterpret_cast<const __m256i *>(tail)),
+                    prev, &check);
+            }
+
+            // Nothing may be left incomplete at the end.
+            __m256i error = _mm256_or_si256(check.error, check.incomplete);
+            if (_mm256_testz_si256(error, error)) {
+                return end - start;
+            }
+            return validate_utf8_scalar(start, end);
+        }
+#endif
+
+        /// Prefix XOR: bit i of the result is the XOR of bits 0..i of x.
+        std::uint64_t prefix_xor(std::uint64_t x) {
+            x ^= x << 1;
+            x ^= x << 2;
+            x ^= x << 4;
+            x ^= x << 8;
+            x ^= x << 16;
+            x ^= x << 32;
+            return x;
+        }
+    } // namespace
+
+    const Kernels &select_kernels() {
+#ifdef JSON_SCAN_X86
+        static const Kernels selected = []() -> Kernels {
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) {
+                return {&classify_avx2, &find_string_special_avx2,
+                        &validate_utf8_avx2};
+            }
+            if (__builtin_cpu_supports("sse2")) {
+                return {&classify_sse2, &find_string_special_sse2,
+                        &validate_utf8_sse2};
+            }
+            return {&classify_scalar, &find_string_special_scalar,
+                    &validate_utf8_scalar};
+        }();
+#else
+        static const Kernels selected = {&classify_scalar,
+                                         &find_string_special_scalar,
+                                         &validate_utf8_scalar};
+#endif
+        return selected;
+    }
+
+    std::uint64_t StructuralScanner::find_escaped(std::uint64_t backslash) {
+        // Marks the byte following each odd-length run of backslashes; see
+        // "Parsing Gigabytes of JSON per Second" (Langdale, Lemire), 3.1.1.
+        constexpr std::uint64_t even_bits = 0x5555555555555555ULL;
+        constexpr std::uint64_t odd_bits = ~even_bits;
+
+        std::uint64_t start_edges = backslash & ~(backslash << 1);
+        std::uint64_t even_start_mask = even_bits ^ prev_ends_odd_backslash_;
+        std::uint64_t even_starts = start_edges & even_start_mask;
+        std::uint64_t odd_starts = start_edges & ~even_start_mask;
+        std::uint64_t even_carries = backslash + even_starts;
+
+        std::uint64_t odd_carries = backslash + odd_starts;
+        bool ends_odd_backslash = odd_carries < backslash;
+        odd_carries |= prev_ends_odd_backslash_;
+        prev_ends_odd_backslash_ = ends_odd_backslash ? 1 : 0;
+
+        std::uint64_t even_carry_ends = even_carries & ~backslash;
+        std::uint64_t odd_carry_ends = odd_carries & ~backslash;
+        std::uint64_t even_start_odd_end = even_carry_ends & odd_bits;
+        std::uint64_t odd_start_even_end = odd_carry_ends & even_bits;
+        return even_start_odd_end | odd_start_even_end;
+    }
+
+    std::uint64_t StructuralScanner::next(const BlockMasks &masks) {
+        std::uint64_t quote = masks.quote & ~find_escaped(masks.backslash);
+
+        // Set from an opening quote up to, but excluding, its closing quote.
+        std::uint64_t in_string = prefix_xor(quote) ^ prev_in_string_;
+        prev_in_string_ =
+            static_cast<std::uint64_t>(static_cast<std::int64_t>(in_string) >>
+                                       63);
+
+        std::uint64_t open_quote = quote & in_string;
+        std::uint64_t op = masks.op & ~in_string;
+
+        std::uint64_t scalar =
+            ~(masks.op | masks.whitespace | masks.quote | in_string);
+        std::uint64_t follows_scalar = (scalar << 1) | prev_scalar_;
+        prev_scalar_ = scalar >> 63;
+
+        return op | open_quote | (scalar & ~follows_scalar);
+    }
+} // namespace json::detail
@@ -0,0 +1,76 @@
+/* -*- mode: c++ -*- */
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace json::detail {
+    /// Number of input bytes classified per step.
+    constexpr std::size_t SCAN_BLOCK_SIZE = 64;
+
+    /// Raw per-byte classification of one block.  Bit i describes byte i of
+    /// the block.
+    struct BlockMasks {
+        std::uint64_t whitespace;
+        std::uint64_t op; // {}[]:,
+        std::uint64_t quote;
+        std::uint64_t backslash;
+    };
+
+    /// Classifies exactly SCAN_BLOCK_SIZE bytes starting at `block'.
+    using ClassifyFn = void (*)(const char *block, BlockMasks *masks);
+
+    /// Returns the offset from `p' of the first byte in [p, end) that ends a
+    /// clean run inside a string: a quote, a backslash or a control
+    /// character (< 0x20).  Returns end - p if there is none.
+    using StringSpecialFn = std::size_t (*)(const char *p, const char *end);
+
+    /// Returns the offset from `p' of the first byte of the first sequence
+    /// in [p, end) that is not well-formed UTF-8 (a stray continuation
+    /// byte, a truncated sequence, an overlong form, a surrogate or a code
+    /// point beyond U+10FFFF).  Returns end - p if the whole range is valid.
+    using Utf8ValidateFn = std::size_t (*)(const char *p, const char *end);
+
+    struct Kernels {
+        ClassifyFn classify;
+        StringSpecialFn find_string_special;
+        Utf8ValidateFn validate_utf8;
+    };
+
+    /// Returns the fastest kernels the running CPU supports (AVX2, SSE2 or
+    /// portable scalar code).  The choice is made once per process.
+    const Kernels &select_kernels();
+
+    /// Turns a stream of BlockMasks into structural indexes in the style of
+    /// simdjson's stage 1.  A set bit marks a byte the lexer has to look at:
+    /// an operator outside a string, the opening quote of a string, or the
+    /// first byte of a scalar (number, literal or garbage).  Whitespace and
+    /// string contents never have a bit set, so the lexer can jump from one
+    /// bit to the next.  Escape and in-string state is carried across blocks,
+    /// so blocks must be fed in order.
+    class StructuralScanner {
+        std::uint64_t prev_ends_odd_backslash_ = 0;
+        std::uint64_t prev_in_string_ = 0;
+        std::uint64_t prev_scalar_ = 0;
+
+        std::uint64_t find_escaped(std::uint64_t backslash);
+
+    public:
+        StructuralScanner() = default;
+
+        /// Starts a scan in the middle of the input, after bytes that end
+        /// inside a string if `in_string', and in an odd-length run of
+        /// backslashes if `escaped'.
+        StructuralScanner(bool in_string, bool escaped)
+            : prev_ends_odd_backslash_(escaped ? 1 : 0),
+              prev_in_string_(in_string ? ~std::uint64_t(0) : 0) {}
+
+        std::uint64_t next(const BlockMasks &masks);
+
+        /// True if the last block fed ended inside a string.
+        bool in_string() const { return prev_in_string_ != 0; }
+    };
+} // namespace json::detail
+
+#endif
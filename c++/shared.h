@@ -0,0 +1,47 @@
+/* -*- mode: c++ -*- */
+#ifndef SHARED_H
+#define SHARED_H
+
+#include <memory>
+
+#include "parse.h"
+
+namespace json {
+    /// A parsed document frozen for reading, which copies share by
+    /// reference counting.  Once a JSON_File has been moved in, nothing
+    /// can reach it but the const accessors here and of the nodes, and
+    /// these never write: objects build their hash index while they are
+    /// filled rather than on first lookup, and there are no other caches.
+    /// Any number of threads may therefore read the same tree at once,
+    /// without locks.  The tree is freed with the last copy.
+    ///
+    /// Copying touches the shared reference count, which all threads
+    /// write, so threads that only read should take the document by
+    /// reference; the count is only needed to hand it over or keep it.
+    class SharedDocument {
+        std::shared_ptr<const JSON_File> file_;
+
+    public:
+        /// A document that is not ok() and has no root.
+        SharedDocument() = default;
+
+        explicit SharedDocument(JSON_File &&file)
+            : file_(std::make_shared<const JSON_File>(std::move(file))) {}
+
+        bool ok() const { return file_ != nullptr && file_->ok(); }
+
+        const JSON_Primitive *get_root() const {
+            return file_ != nullptr ? file_->get_root() : nullptr;
+        }
+
+        /// Why the parse failed; see JSON_File::get_error().
+        ParseError get_error() const {
+            return file_ != nullptr ? file_->get_error() : ParseError();
+        }
+
+        /// Number of copies sharing the document.
+        long use_count() const { return file_.use_count(); }
+    };
+} // namespace json
+
+#endif
@@ -0,0 +1,181 @@
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "stats.h"
+#include "parse.h"
+#include "sax.h"
+
+namespace json {
+    namespace {
+        std::uint64_t now_ns() {
+            return static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch())
+                    .count());
+        }
+
+        /// A Lexer that runs ahead of the Grammar, a batch of tokens at a
+        /// time, so that each phase is timed once per batch rather than
+        /// once per token.  It has the Lexer's accessors, for the tokens
+        /// it hands out, so that parse_document() can run on it.
+        class BatchedLexer {
+            static constexpr std::size_t BATCH_SIZE = 1024;
+
+            struct Entry {
+                detail::TokenResult token;
+                const char *start;
+                const char *position;
+            };
+
+            detail::Lexer &lexer_;
+            std::string_view input_;
+            ParseStats *stats_;
+            std::vector<Entry> entries_;
+            // Escaped strings are decoded into the Lexer's buffer, which
+            // the next one overwrites, so they are copied here.  Reserved
+            // for a whole batch, so that the copies never move.
+            std::vector<std::string> decoded_;
+            std::size_t next_ = 0;
+            ParseErrorCode error_ = ParseErrorCode::NONE;
+            const char *error_at_ = nullptr;
+            std::uint64_t phase_start_;
+
+            static std::uint64_t ParseStats::*counter(detail::TokenType type) {
+                switch (type) {
+                case detail::TokenType::OBJ_OPEN:
+                    return &ParseStats::object_opens;
+                case detail::TokenType::OBJ_CLOSE:
+                    return &ParseStats::object_closes;
+                case detail::TokenType::ARRAY_OPEN:
+                    return &ParseStats::array_opens;
+                case detail::TokenType::ARRAY_CLOSE:
+                    return &ParseStats::array_closes;
+                case detail::TokenType::COLON:
+                    return &ParseStats::colons;
+                case detail::TokenType::COMMA:
+                    return &ParseStats::commas;
+                case detail::TokenType::STRING:
+                    return &ParseStats::strings;
+                case detail::TokenType::NUMBER:
+                    return &ParseStats::numbers;
+                case detail::TokenType::TRUE:
+                    return &ParseStats::trues;
+                case detail::TokenType::FALSE:
+                    return &ParseStats::falses;
+                default:
+                    return &ParseStats::nulls;
+                }
+            }
+
+            /// Charges the time since the last switch to `phase'.
+            void end_phase(std::uint64_t ParseStats::*phase) {
+                std::uint64_t now = now_ns();
+                stats_->*phase += now - phase_start_;
+                phase_start_ = now;
+            }
+
+            /// Lexes the next batch, which ends early at the end of the
+            /// input or a token that fails.
+            void refill() {
+                end_phase(&ParseStats::build_ns);
+                entries_.clear();
+                decoded_.clear();
+                std::less_equal<const char *> le;
+                while (entries_.size() < BATCH_SIZE) {
+                    detail::TokenResult tk = lexer_.next();
+                    if (!tk) {
+                        error_ = lexer_.error();
+                        error_at_ = lexer_.error_position();
+                        entries_.push_back({std::move(tk),
+                                            lexer_.token_start(),
+                                            lexer_.position()});
+                        break;
+                    }
+
+                    detail::TokenType type = (*tk).get_type();
+                    std::string_view str = (*tk).get_token();
+                    ++stats_->tokens;
+                    ++(stats_->*counter(type));
+                    if (type == detail::TokenType::STRING &&
+                        !(le(input_.data(), str.data()) &&
+                          le(str.data() + str.size(),
+                             input_.data() + input_.size()))) {
+                        tk = detail::Token(type, decoded_.emplace_back(str));
+                    }
+                    entries_.push_back(
+                        {std::move(tk), lexer_.token_start(), lexer_.position()});
+                }
+                next_ = 0;
+                end_phase(&ParseStats::tokenize_ns);
+            }
+
+        public:
+            BatchedLexer(std::string_view input, detail::Lexer &lexer,
+                         ParseStats *stats)
+                : lexer_(lexer), input_(input), stats_(stats) {
+                entries_.reserve(BATCH_SIZE);
+                decoded_.reserve(BATCH_SIZE);
+                phase_start_ = now_ns();
+            }
+
+            /// Charges the time since the last batch to the Grammar.
+            void finish() { end_phase(&ParseStats::build_ns); }
+
+            detail::TokenResult next() {
+                if (next_ == entries_.size()) {
+                    refill();
+                }
+                return entries_[next_++].token;
+            }
+
+            const char *token_start() const {
+                return entries_[next_ - 1].start;
+            }
+
+            const char *position() const {
+                return entries_[next_ - 1].position;
+            }
+
+            ParseErrorCode error() const { return error_; }
+            const char *error_position() const { return error_at_; }
+        };
+    } // namespace
+
+    JSON_File parse(std::string_view input, ParseStats *stats,
+                    int max_depth) {
+        *stats = ParseStats();
+        stats->collected = JSON_STATS;
+
+        JSON_File result;
+        TreeBuilder builder(result.get_arena());
+        detail::Lexer lexer(input);
+        detail::Grammar<TreeBuilder> grammar(builder, max_depth);
+        ParseError error;
+        bool ok;
+        if (JSON_STATS) {
+            detail::StatsRecorder recorder{stats};
+            builder.set_stats(&recorder);
+            lexer.set_stats(&recorder);
+            grammar.set_stats(&recorder);
+
+            BatchedLexer tokens(input, lexer, stats);
+            ok = detail::parse_document(input, tokens, grammar, &error);
+            tokens.finish();
+
+            stats->bytes = ok ? input.size() : error.offset;
+            stats->arena_blocks = result.get_arena().block_count();
+            stats->arena_bytes = result.get_arena().bytes_reserved();
+        } else {
+            ok = detail::parse_document(input, lexer, grammar, &error);
+        }
+
+        if (ok) {
+            result.set_root(builder.get_root());
+        } else {
+            result.set_error(error);
+        }
+        return result;
+    }
+} // namespace json
@@ -0,0 +1,117 @@
+/* -*- mode: c++ -*- */
+#ifndef STATS_H
+#define STATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "json_config.h"
+
+namespace json {
+    class JSON_File;
+
+    /// What parsing one document took.
+    struct ParseStats {
+        /// False if the instrumentation was compiled out, in which case
+        /// every other field is zero.
+        bool collected = false;
+
+        /// Input read up to the end of the document or the failed token.
+        std::size_t bytes = 0;
+
+        /// Tokens lexed, in all and by type.  Keys are strings, one per
+        /// colon.
+        std::uint64_t tokens = 0;
+        std::uint64_t object_opens = 0;
+        std::uint64_t object_closes = 0;
+        std::uint64_t array_opens = 0;
+        std::uint64_t array_closes = 0;
+        std::uint64_t colons = 0;
+        std::uint64_t commas = 0;
+        std::uint64_t strings = 0;
+        std::uint64_t numbers = 0;
+        std::uint64_t trues = 0;
+        std::uint64_t falses = 0;
+        std::uint64_t nulls = 0;
+
+        /// Strings and keys that had escapes and were decoded.
+        std::uint64_t escaped_strings = 0;
+
+        /// Deepest nesting of containers reached.
+        int max_depth = 0;
+
+        /// Time spent lexing, and in the grammar and the tree builder
+        /// that consume the tokens.
+        std::uint64_t tokenize_ns = 0;
+        std::uint64_t build_ns = 0;
+
+        /// Blocks and bytes the document's arena took from the allocator.
+        std::size_t arena_blocks = 0;
+        std::size_t arena_bytes = 0;
+
+        /// Allocations made by growing the lexer's decoding buffer, the
+        /// grammar's stack of open containers and the tree builder's
+        /// scratch stacks, and the bytes they requested.
+        std::size_t scratch_allocations = 0;
+        std::size_t scratch_bytes = 0;
+
+        /// Every allocation the parse made.
+        std::size_t allocations() const {
+            return arena_blocks + scratch_allocations;
+        }
+    };
+
+    /// parse() that also fills in `*stats'.  The document is parsed once,
+    /// by the same Lexer, Grammar and TreeBuilder as parse(), with the
+    /// hooks below switched on.  The Lexer runs ahead of the Grammar by a
+    /// batch of about a thousand tokens, so that the clock is read twice
+    /// per batch instead of on every token; the token counts of an
+    /// invalid document may therefore include some past the error.  The
+    /// batch buffer is not counted among the allocations.
+    JSON_File parse(std::string_view input, ParseStats *stats,
+                    int max_depth = 64);
+} // namespace json
+
+namespace json::detail {
+    /// What the parser's classes record into while parse() above runs.
+    /// They take a pointer to one that is null otherwise, and test it
+    /// through stats_on(), which is constant false with JSON_STATS=0, so
+    /// the hooks compile to nothing.
+    struct StatsRecorder {
+        ParseStats *stats;
+    };
+
+    inline bool stats_on(const StatsRecorder *recorder) {
+        return JSON_STATS && recorder != nullptr;
+    }
+
+    template <typename Buffer>
+    std::size_t stats_heap_bytes(const Buffer &buffer) {
+        return buffer.capacity() * sizeof(typename Buffer::value_type);
+    }
+
+    inline std::size_t stats_heap_bytes(const std::vector<bool> &buffer) {
+        return buffer.capacity() / 8;
+    }
+
+    /// Runs `grow', which may reallocate `buffer', a std::vector or
+    /// std::string, and counts the allocation if it did.
+    template <typename Buffer, typename Grow>
+    void stats_track(StatsRecorder *recorder, const Buffer &buffer,
+                     Grow grow) {
+        if (!stats_on(recorder)) {
+            grow();
+            return;
+        }
+        std::size_t capacity = buffer.capacity();
+        grow();
+        if (buffer.capacity() != capacity) {
+            ++recorder->stats->scratch_allocations;
+            recorder->stats->scratch_bytes += stats_heap_bytes(buffer);
+        }
+    }
+} // namespace json::detail
+
+#endif
@@ -0,0 +1,206 @@
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+#include "parallel.h"
+#include "stream.h"
+
+namespace json {
+    namespace {
+        /// Chunks are at least this large, so that small inputs are not
+        /// spread over threads that would mostly wait for each other.
+        constexpr std::size_t MIN_CHUNK_SIZE = 256 * 1024;
+
+        /// How many chunks each thread gets on average.  Taking them from
+        /// a shared counter evens out lines of different cost.
+        constexpr std::size_t CHUNKS_PER_THREAD = 8;
+
+        /// The bytes a value can start with, and those of the other
+        /// tokens.
+        constexpr std::string_view VALUE_START = "{[\"-0123456789tfn";
+        constexpr std::string_view PUNCTUATION = "]},:";
+
+        /// Cuts `input' into pieces of about `size' bytes that each end
+        /// just past a newline, or at the end of the input.
+        std::vector<std::string_view> split_lines(std::string_view input,
+                                                  std::size_t size) {
+            std::vector<std::string_view> chunks;
+            std::size_t begin = 0;
+            while (begin < input.size()) {
+                std::size_t end = input.size();
+                if (input.size() - begin > size) {
+                    std::size_t newline = input.find('\n', begin + size);
+                    if (newline != std::string_view::npos) {
+                        end = newline + 1;
+                    }
+                }
+                chunks.push_back(input.substr(begin, end - begin));
+                begin = end;
+            }
+            return chunks;
+        }
+
+        struct ChunkResult {
+            std::vector<JSON_File> documents;
+            std::size_t newlines = 0;
+        };
+
+        /// What the documents of a chunk are built in.
+        struct ChunkStorage {
+            Arena arena;
+            // Records mostly repeat the same keys.
+            KeyInterner keys;
+        };
+
+        /// Errors are located within `chunk'.
+        ChunkResult parse_chunk(std::string_view chunk, int max_depth) {
+            ChunkResult result;
+            auto storage = std::make_shared<ChunkStorage>();
+            DocumentStream stream(chunk, max_depth);
+            // The storage keeps the interner alive.
+            stream.set_keys(std::shared_ptr<KeyInterner>(storage,
+                                                         &storage->keys));
+            JSON_Primitive *root;
+            while (stream.next(storage->arena, &root)) {
+                JSON_File &doc = result.documents.emplace_back();
+                if (root != nullptr) {
+                    doc.set_root(root);
+                    doc.set_source(storage);
+                } else {
+                    doc.set_error(stream.error());
+                }
+            }
+            result.newlines = static_cast<std::size_t>(
+                std::count(chunk.begin(), chunk.end(), '\n'));
+            return result;
+        }
+    } // namespace
+
+    DocumentStream::DocumentStream(std::string_view input, int max_depth)
+        : input_(input), lexer_(input), grammar_(builder_, max_depth) {}
+
+    const char *DocumentStream::next_line(const char *p) const {
+        const char *end = input_.data() + input_.size();
+        auto *newline =
+            static_cast<const char *>(std::memchr(p, '\n', end - p));
+        return newline == nullptr ? end : newline + 1;
+    }
+
+    void DocumentStream::fail(const char *document_start,
+                              const detail::TokenResult *failure) {
+        auto start = static_cast<std::size_t>(document_start - input_.data());
+        lines_.advance(input_.substr(lines_.offset(), start - lines_.offset()));
+        error_ = detail::describe_failure(input_.substr(start), lexer_,
+                                          grammar_, failure, lines_);
+
+        // The lines up to the token the parse stopped at belong to the
+        // failed document, and so does that token's line, unless the
+        // token could start the next one.
+        const char *end = input_.data() + input_.size();
+        const char *stop = lexer_.token_start();
+        const char *restart;
+        if (stop != end && stop > document_start && stop[-1] == '\n' &&
+            VALUE_START.find(*stop) != std::string_view::npos) {
+            restart = stop;
+        } else {
+            restart = next_line(stop);
+        }
+        // So do the indented lines after it, and those that start by
+        // closing a container or separating values in one.
+        while (restart != end &&
+               (*restart == ' ' || *restart == '\t' ||
+                PUNCTUATION.find(*restart) != std::string_view::npos)) {
+            restart = next_line(restart);
+        }
+        lexer_.reset(std::string_view(restart, end - restart));
+    }
+
+    bool DocumentStream::next(Arena &arena, JSON_Primitive **root) {
+        builder_.reset(arena);
+        grammar_.reset();
+        *root = nullptr;
+
+        const char *start = nullptr;
+        for (;;) {
+            detail::TokenResult tk = lexer_.next();
+            if (!tk) {
+                if (start == nullptr &&
+                    tk.get_error() == detail::TokenResult::Error::END) {
+                    return false;
+                }
+                // A bad token, or the input ends inside the document.
+                fail(start != nullptr ? start : lexer_.token_start(), &tk);
+                return true;
+            }
+            if (start == nullptr) {
+                start = lexer_.token_start();
+            }
+            if (!grammar_.next(*tk)) {
+                fail(start, nullptr);
+                return true;
+            }
+            if (grammar_.done()) {
+                *root = builder_.get_root();
+                return true;
+            }
+        }
+    }
+
+    void DocumentStream::set_keys(std::shared_ptr<KeyInterner> keys) {
+        keys_ = std::move(keys);
+        builder_.set_keys(keys_.get());
+    }
+
+    bool DocumentStream::next(JSON_File *doc) {
+        doc->reset();
+        JSON_Primitive *root;
+        if (!next(doc->get_arena(), &root)) {
+            return false;
+        }
+        doc->set_source(keys_);
+        if (root != nullptr) {
+            doc->set_root(root);
+        } else {
+            doc->set_error(error_);
+        }
+        return true;
+    }
+
+    std::vector<JSON_File> parse_ndjson(std::string_view input,
+                                        unsigned threads, int max_depth) {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        std::size_t chunk_size = std::max(
+            MIN_CHUNK_SIZE, input.size() / (threads * CHUNKS_PER_THREAD));
+        std::vector<std::string_view> chunks = split_lines(input, chunk_size);
+
+        std::vector<ChunkResult> results(chunks.size());
+        detail::run_parallel(chunks.size(), threads, [&](std::size_t i) {
+            results[i] = parse_chunk(chunks[i], max_depth);
+        });
+
+        std::size_t count = 0;
+        for (const ChunkResult &result : results) {
+            count += result.documents.size();
+        }
+        std::vector<JSON_File> documents;
+        documents.reserve(count);
+        std::size_t lines = 0;
+        for (std::size_t i = 0; i < chunks.size(); ++i) {
+            for (JSON_File &doc : results[i].documents) {
+                if (!doc.ok()) {
+                    // Chunks start at the start of a line.
+                    ParseError error = doc.get_error();
+                    error.offset += chunks[i].data() - input.data();
+                    error.line += lines;
+                    doc.set_error(error);
+                }
+                documents.push_back(std::move(doc));
+            }
+            lines += results[i].newlines;
+        }
+        return documents;
+    }
+} // namespace json
@@ -0,0 +1,106 @@
+/* -*- mode: c++ -*- */
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "parse.h"
+#include "sax.h"
+
+namespace json {
+    /// Reads a sequence of root values from one buffer: newline-delimited
+    /// JSON (NDJSON, JSON Lines), or values that are simply concatenated or
+    /// separated by any whitespace.  One lexer runs over the whole input,
+    /// and the scratch stacks of the tree builder are kept from one document
+    /// to the next.
+    ///
+    /// A malformed document is reported as a JSON_File whose ok() is
+    /// false, and reading resumes at the first line after the one where
+    /// parsing it stopped that is not indented and does not start with a
+    /// closing bracket, a comma or a colon.  One bad record thus does not
+    /// lose the rest of an NDJSON stream, and the inner lines of a bad
+    /// pretty-printed document do not come out as documents of their
+    /// own; in
+    ///
+    ///   [
+    ///     {"a": 1},
+    ///     {"a": 2}, oops
+    ///   ]
+    ///   {"b": 3}
+    ///
+    /// the array is one error and {"b": 3} the next document.  If parsing
+    /// stopped at a token that opens a later line than the document's
+    /// first and could start a value, reading resumes at that token
+    /// instead, so that in
+    ///
+    ///   {"a": [1, 2
+    ///   {"b": 3}
+    ///
+    /// {"b": 3} survives the record before it being cut short.  A good
+    /// document that is indented on the line after a bad one is skipped
+    /// with it.
+    ///
+    /// Strings are copied as by parse(); `input' has to outlive the
+    /// DocumentStream but not the documents.
+    class DocumentStream {
+        std::string_view input_;
+        detail::Lexer lexer_;
+        TreeBuilder builder_;
+        detail::Grammar<TreeBuilder> grammar_;
+        detail::LineCounter lines_;
+        ParseError error_;
+        std::shared_ptr<KeyInterner> keys_;
+
+        /// Where the line after the one `p' is on starts, or the end.
+        const char *next_line(const char *p) const;
+
+        /// Records the error of the document at `document_start' and
+        /// moves past it as described above.
+        void fail(const char *document_start,
+                  const detail::TokenResult *failure);
+
+    public:
+        /// max_depth applies to each document and has the meaning
+        /// documented for parse().
+        explicit DocumentStream(std::string_view input, int max_depth = 64);
+
+        DocumentStream(const DocumentStream &) = delete;
+        DocumentStream &operator=(const DocumentStream &) = delete;
+
+        /// Parses the next document into `doc', which is reset() first, so
+        /// passing the same JSON_File every time reuses its arena.  Returns
+        /// false, leaving `doc' empty, when only whitespace is left.
+        bool next(JSON_File *doc);
+
+        /// Like next(), but builds the document in `arena', which may be
+        /// shared by many documents.  `*root' is set to nullptr if the
+        /// document is malformed, and error() says why; the nodes built for
+        /// it up to the error stay in the arena.
+        bool next(Arena &arena, JSON_Primitive **root);
+
+        /// Interns the keys of the following documents in `keys', so that
+        /// records with the same keys share them; nullptr stops interning.
+        /// Documents from next(JSON_File *) keep `keys' alive, while those
+        /// built by next(Arena &, ...) need it to outlive them.
+        void set_keys(std::shared_ptr<KeyInterner> keys);
+
+        /// The error of the last malformed document.  Offsets, lines and
+        /// columns are positions in the whole input.
+        const ParseError &error() const { return error_; }
+    };
+
+    /// Parses newline-delimited JSON on `threads' threads, or one per
+    /// hardware thread if 0.  The input is cut into chunks at line breaks,
+    /// which the threads take in turn, so every document must fit on one
+    /// line; a line may also hold several documents as for DocumentStream.
+    /// The documents of a chunk share an arena that lives as long as any
+    /// of them.  The result is in input order, with a JSON_File whose ok()
+    /// is false for each malformed document.
+    std::vector<JSON_File> parse_ndjson(std::string_view input,
+                                        unsigned threads = 0,
+                                        int max_depth = 64);
+} // namespace json
+
+#endif
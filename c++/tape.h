@@ -0,0 +1,296 @@
+/* -*- mode: c++ -*- */
+#ifndef TAPE_H
+#define TAPE_H
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "parse.h"
+namespace json {
+    /// Type tag stored in the top byte of every tape word.
+    enum class TapeTag : std::uint8_t {
+        ARRAY_OPEN = '[',
+        ARRAY_CLOSE = ']',
+        OBJECT_OPEN = '{',
+        OBJECT_CLOSE = '}',
+        STRING = '"',
+        INT64 = 'l',
+        UINT64 = 'u',
+        DOUBLE = 'd',
+        TRUE_VALUE = 't',
+        FALSE_VALUE = 'f',
+        NULL_VALUE = 'n',
+    };
+
+    /// Element counts at or above this value are not stored on the tape.
+    constexpr std::uint64_t TAPE_COUNT_SATURATED = 0xffffff;
+
+    class Tape;
+    class TapeValue;
+    class TapeElementIterator;
+    class TapeMemberIterator;
+
+    /// A document flattened into 64-bit words, as an alternative to the
+    /// JSON_Primitive tree.  Values are laid out in document order:
+    ///
+    ///  - `[' and `{' words hold the index just past their matching close
+    ///    word in bits 0-31 and the number of elements or members in bits
+    ///    32-55 (TAPE_COUNT_SATURATED if there are more).  The close word
+    ///    holds the index of the open word.
+    ///  - Object members are a STRING word for the key followed by the
+    ///    value.
+    ///  - STRING words hold an offset into the string buffer, where the
+    ///    contents are stored after a 32-bit length.
+    ///  - INT64, UINT64 and DOUBLE words are followed by one word with the
+    ///    raw value.
+    ///  - true, false and null are a single word.
+    ///
+    /// Skipping any value is O(1), and walking a container touches
+    /// consecutive memory only.
+    class Tape {
+        bool ok_ = false;
+        ParseError error_;
+        std::vector<std::uint64_t> words_;
+        std::string strings_;
+
+        friend class TapeValue;
+        friend Tape parse_tape(std::string_view input, int max_depth);
+
+    public:
+        bool ok() const { return ok_; }
+
+        /// Why ok() is false.
+        const ParseError &get_error() const { return error_; }
+
+        TapeValue get_root() const;
+
+        const std::vector<std::uint64_t> &words() const { return words_; }
+    };
+
+    /// Cursor referring to one value on a Tape.  Cheap to copy; valid as
+    /// long as the Tape is.
+    class TapeValue {
+        const Tape *tape_ = nullptr;
+        std::size_t index_ = 0;
+
+        static constexpr std::uint64_t PAYLOAD_MASK = (1ULL << 56) - 1;
+
+        std::uint64_t word(std::size_t index) const {
+            return tape_->words_[index];
+        }
+
+        std::uint64_t payload() const { return word(index_) & PAYLOAD_MASK; }
+
+        std::string_view string_at(std::uint64_t offset) const {
+            std::uint32_t length;
+            std::memcpy(&length, tape_->strings_.data() + offset,
+                        sizeof(length));
+            return {tape_->strings_.data() + offset + sizeof(length), length};
+        }
+
+    public:
+        template <typename Iterator> struct Range {
+            Iterator first;
+            Iterator last;
+
+            Iterator begin() const { return first; }
+            Iterator end() const { return last; }
+        };
+
+        /// An invalid value; see valid().
+        TapeValue() = default;
+
+        TapeValue(const Tape *tape, std::size_t index)
+            : tape_(tape), index_(index) {}
+
+        /// False for the result of a failed lookup.
+        bool valid() const { return tape_ != nullptr; }
+
+        TapeTag get_tag() const {
+            return static_cast<TapeTag>(word(index_) >> 56);
+        }
+
+        bool is_null() const { return get_tag() == TapeTag::NULL_VALUE; }
+
+        bool is_array() const { return get_tag() == TapeTag::ARRAY_OPEN; }
+
+        bool is_object() const { return get_tag() == TapeTag::OBJECT_OPEN; }
+
+        bool get_bool() const { return get_tag() == TapeTag::TRUE_VALUE; }
+
+        std::int64_t get_int64() const {
+            return static_cast<std::int64_t>(word(index_ + 1));
+        }
+
+        std::uint64_t get_uint64() const { return word(index_ + 1); }
+
+        /// Any number as a double.
+        double get_double() const {
+            switch (get_tag()) {
+            case TapeTag::INT64:
+                return static_cast<double>(get_int64());
+            case TapeTag::UINT64:
+                return static_cast<double>(get_uint64());
+            default:
+                return std::bit_cast<double>(word(index_ + 1));
+            }
+        }
+
+        std::string_view get_string() const { return string_at(payload()); }
+
+        /// Index of the word following this value.  O(1), also for
+        /// containers.
+        std::size_t next_index() const {
+            switch (get_tag()) {
+            case TapeTag::ARRAY_OPEN:
+            case TapeTag::OBJECT_OPEN:
+                return payload() & 0xffffffff;
+            case TapeTag::INT64:
+            case TapeTag::UINT64:
+            case TapeTag::DOUBLE:
+                return index_ + 2;
+            default:
+                return index_ + 1;
+            }
+        }
+
+        /// Number of elements or members of a container.  O(1) unless the
+        /// count saturated.
+        std::size_t size() const;
+
+        Range<TapeElementIterator> elements() const;
+
+        Range<TapeMemberIterator> members() const;
+
+        /// Looks up a member of an object.  Returns an invalid value if
+        /// there is none; with duplicate keys the last one wins, as in
+        /// JSON_Object.
+        TapeValue operator[](std::string_view key) const;
+
+        /// Returns the element at `index' of an array, or an invalid value.
+        TapeValue at(std::size_t index) const;
+    };
+
+    /// Iterates over the elements of an array.
+    class TapeElementIterator {
+        const Tape *tape_;
+        std::size_t index_;
+
+    public:
+        using value_type = TapeValue;
+        using difference_type = std::ptrdiff_t;
+
+        TapeElementIterator() = default;
+        TapeElementIterator(const Tape *tape, std::size_t index)
+            : tape_(tape), index_(index) {}
+
+        TapeValue operator*() const { return TapeValue(tape_, index_); }
+
+        TapeElementIterator &operator++() {
+            index_ = TapeValue(tape_, index_).next_index();
+            return *this;
+        }
+
+        TapeElementIterator operator++(int) {
+            TapeElementIterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        bool operator==(const TapeElementIterator &other) const {
+            return index_ == other.index_;
+        }
+    };
+
+    struct TapeMember {
+        std::string_view key;
+        TapeValue value;
+    };
+
+    /// Iterates over the members of an object.
+    class TapeMemberIterator {
+        const Tape *tape_;
+        std::size_t index_;
+
+    public:
+        using value_type = TapeMember;
+        using difference_type = std::ptrdiff_t;
+
+        TapeMemberIterator() = default;
+        TapeMemberIterator(const Tape *tape, std::size_t index)
+            : tape_(tape), index_(index) {}
+
+        TapeMember operator*() const {
+            return {TapeValue(tape_, index_).get_string(),
+                    TapeValue(tape_, index_ + 1)};
+        }
+
+        TapeMemberIterator &operator++() {
+            index_ = TapeValue(tape_, index_ + 1).next_index();
+            return *this;
+        }
+
+        TapeMemberIterator operator++(int) {
+            TapeMemberIterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        bool operator==(const TapeMemberIterator &other) const {
+            return index_ == other.index_;
+        }
+    };
+
+    inline std::size_t TapeValue::size() const {
+        std::uint64_t count = (payload() >> 32) & TAPE_COUNT_SATURATED;
+        if (count < TAPE_COUNT_SATURATED) {
+            return count;
+        }
+        return is_array()
+                   ? std::distance(elements().begin(), elements().end())
+                   : std::distance(members().begin(), members().end());
+    }
+
+    inline TapeValue::Range<TapeElementIterator> TapeValue::elements() const {
+        return {TapeElementIterator(tape_, index_ + 1),
+                TapeElementIterator(tape_, next_index() - 1)};
+    }
+
+    inline TapeValue::Range<TapeMemberIterator> TapeValue::members() const {
+        return {TapeMemberIterator(tape_, index_ + 1),
+                TapeMemberIterator(tape_, next_index() - 1)};
+    }
+
+    inline TapeValue TapeValue::operator[](std::string_view key) const {
+        TapeValue found;
+        for (const TapeMember &member : members()) {
+            if (member.key == key) {
+                found = member.value;
+            }
+        }
+        return found;
+    }
+
+    inline TapeValue TapeValue::at(std::size_t index) const {
+        for (TapeValue element : elements()) {
+            if (index-- == 0) {
+                return element;
+            }
+        }
+        return TapeValue();
+    }
+
+    inline TapeValue Tape::get_root() const { return TapeValue(this, 0); }
+
+    /// Parses `input' into a Tape instead of a JSON_Primitive tree.  A
+    /// document of 2^32 or more words, or with a string of 4 GiB or more,
+    /// does not fit the 32-bit fields above and fails with TOO_LARGE.
+    Tape parse_tape(std::string_view input, int max_depth = 64);
+} // namespace json
+
+#endif
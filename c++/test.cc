@@ -1,18 +1,20 @@
 #include <iostream>
 
 #include "parse.h"
+#include "writer.h"
 
 int main(int argc, char **argv) {
-    std::ifstream ifs(argv[1]);
     json::JSON_File result;
     if (argc < 2) {
         result = json::parse(std::cin);
     } else {
-        result = json::parse(ifs);
+        result = json::parse_file(argv[1]);
     }
     if (!result.ok()) {
         std::cout << "Parse error.\n";
         return 1;
     }
-    std::cout << result.get_root()->to_string() << '\n';
+    json::Writer writer(std::cout);
+    writer.write(*result.get_root());
+    writer.write_raw("\n");
 }
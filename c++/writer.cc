@@ -0,0 +1,209 @@
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+
+#include <unistd.h>
+
+#include "scan.h"
+#include "writer.h"
+
+namespace json {
+    namespace {
+        const char HEX_DIGITS[] = "0123456789abcdef";
+
+        /// The short escapes JSON defines for control characters, or 0
+        /// where \u00XX has to be used.
+        const char SHORT_ESCAPES[0x20] = {
+            0, 0, 0, 0, 0, 0, 0, 0, 'b', 't', 'n', 0, 'f', 'r', 0, 0,
+            0, 0, 0, 0, 0, 0, 0, 0, 0,   0,   0,   0, 0,   0,   0, 0,
+        };
+    } // namespace
+
+    namespace detail {
+        /// Clean runs are found with the same kernel the lexer uses to
+        /// scan strings, since the bytes that end a run there are exactly
+        /// the ones that need escaping here.
+        void write_string(std::string *out, std::string_view str) {
+            static const StringSpecialFn find_string_special =
+                select_kernels().find_string_special;
+
+            out->push_back('"');
+            const char *p = str.data();
+            const char *end = p + str.size();
+            for (;;) {
+                std::size_t run = find_string_special(p, end);
+                out->append(p, run);
+                p += run;
+                if (p == end) {
+                    break;
+                }
+
+                unsigned char c = static_cast<unsigned char>(*p++);
+                out->push_back('\\');
+                if (c == '"' || c == '\\') {
+                    out->push_back(static_cast<char>(c));
+                } else if (SHORT_ESCAPES[c] != 0) {
+                    out->push_back(SHORT_ESCAPES[c]);
+                } else {
+                    char escape[] = {'u', '0', '0', HEX_DIGITS[c >> 4],
+                                     HEX_DIGITS[c & 0xf]};
+                    out->append(escape, sizeof(escape));
+                }
+            }
+            out->push_back('"');
+        }
+    } // namespace detail
+
+    void Writer::write(const JSON_Primitive &root) {
+        const JSON_Primitive *value = &root;
+        for (;;) {
+            bool is_container = false;
+            if (value->get_type() == JSON_Type::ARRAY) {
+                buffer_.push_back('[');
+                is_container = true;
+            } else if (value->get_type() == JSON_Type::OBJECT &&
+                       !static_cast<const JSON_Object *>(value)->is_null()) {
+                buffer_.push_back('{');
+                is_container = true;
+            } else {
+                write_scalar(*value);
+            }
+            if (is_container) {
+                frames_.push_back({value, 0});
+            }
+
+            // Find the next value to write, closing finished containers.
+            value = nullptr;
+            while (value == nullptr && !frames_.empty()) {
+                Frame &frame = frames_.back();
+                if (frame.container->get_type() == JSON_Type::ARRAY) {
+                    auto *array =
+                        static_cast<const JSON_Array *>(frame.container);
+                    if (frame.next == array->size()) {
+                        buffer_.push_back(']');
+                        frames_.pop_back();
+                        continue;
+                    }
+                    if (frame.next != 0) {
+                        buffer_.push_back(',');
+                    }
+                    value = array->get(frame.next++);
+                } else {
+                    auto *object =
+                        static_cast<const JSON_Object *>(frame.container);
+                    if (frame.next == object->size()) {
+                        buffer_.push_back('}');
+                        frames_.pop_back();
+                        continue;
+                    }
+                    if (frame.next != 0) {
+                        buffer_.push_back(',');
+                    }
+                    const JSON_Member &member = object->begin()[frame.next++];
+                    detail::write_string(&buffer_, member.key);
+                    buffer_.push_back(':');
+                    value = member.value;
+                }
+            }
+            maybe_flush();
+            if (value == nullptr) {
+                return;
+            }
+        }
+    }
+
+    void Writer::write_raw(std::string_view text) {
+        buffer_.append(text);
+        maybe_flush();
+    }
+
+    void Writer::write_scalar(const JSON_Primitive &value) {
+        switch (value.get_type()) {
+        case JSON_Type::BOOLEAN:
+            if (static_cast<const JSON_Boolean &>(value).get_value()) {
+                buffer_.append("true");
+            } else {
+                buffer_.append("false");
+            }
+            break;
+        case JSON_Type::NUMBER:
+            write_number(static_cast<const JSON_Number &>(value));
+            break;
+        case JSON_Type::STRING:
+            detail::write_string(
+                &buffer_, static_cast<const JSON_String &>(value).get_value());
+            break;
+        default:
+            // Only the null object gets here.
+            buffer_.append("null");
+            break;
+        }
+    }
+
+    void Writer::write_number(const JSON_Number &number) {
+        // Enough for any int64, uint64 or shortest double.
+        char digits[32];
+        std::to_chars_result result;
+        switch (number.get_kind()) {
+        case JSON_Number::Kind::INT64:
+            result = std::to_chars(digits, digits + sizeof(digits),
+                                   number.get_int64());
+            break;
+        case JSON_Number::Kind::UINT64:
+            result = std::to_chars(digits, digits + sizeof(digits),
+                                   number.get_uint64());
+            break;
+        default:
+            if (!std::isfinite(number.get_value())) {
+                buffer_.append("null");
+                return;
+            }
+            result = std::to_chars(digits, digits + sizeof(digits),
+                                   number.get_value());
+            break;
+        }
+        buffer_.append(digits, result.ptr);
+    }
+
+    void Writer::maybe_flush() {
+        if (buffer_.size() >= FLUSH_THRESHOLD) {
+            flush();
+        }
+    }
+
+    bool Writer::flush() {
+        if (stream_ == nullptr && fd_ < 0) {
+            return true;
+        }
+
+        // Once the sink has failed, further output is dropped.
+        if (ok_ && stream_ != nullptr) {
+            stream_->write(buffer_.data(),
+                           static_cast<std::streamsize>(buffer_.size()));
+            ok_ = static_cast<bool>(*stream_);
+        } else if (ok_) {
+            const char *p = buffer_.data();
+            std::size_t left = buffer_.size();
+            while (left != 0) {
+                ssize_t written = ::write(fd_, p, left);
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    ok_ = false;
+                    break;
+                }
+                p += written;
+                left -= static_cast<std::size_t>(written);
+            }
+        }
+        buffer_.clear();
+        return ok_;
+    }
+
+    std::string JSON_Primitive::to_string() const {
+        Writer writer;
+        writer.write(*this);
+        return writer.take();
+    }
+} // namespace json
@@ -0,0 +1,88 @@
+/* -*- mode: c++ -*- */
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "parse.h"
+
+namespace json::detail {
+    /// Appends `str' to `*out' quoted and escaped as a JSON string.
+    void write_string(std::string *out, std::string_view str);
+} // namespace json::detail
+
+namespace json {
+    /// Serializes trees as compact JSON into a single growable buffer.  A
+    /// Writer made for an std::ostream or a file descriptor hands the buffer
+    /// over whenever it exceeds FLUSH_THRESHOLD and on flush(); one made
+    /// without a sink just accumulates, and the text is read with str() or
+    /// take().
+    ///
+    /// Numbers are written in their shortest round-trip form, strings are
+    /// escaped, and the tree is walked without recursion.  Doubles that are
+    /// not finite, which no parsed document contains, are written as null.
+    class Writer {
+    public:
+        static constexpr std::size_t FLUSH_THRESHOLD = 64 * 1024;
+
+    private:
+        struct Frame {
+            const JSON_Primitive *container;
+            std::size_t next;
+        };
+
+        std::string buffer_;
+        std::ostream *stream_ = nullptr;
+        int fd_ = -1;
+        bool ok_ = true;
+        std::vector<Frame> frames_;
+
+        void write_scalar(const JSON_Primitive &value);
+        void write_number(const JSON_Number &number);
+        void maybe_flush();
+
+    public:
+        Writer() = default;
+
+        /// `out' must outlive the Writer.
+        explicit Writer(std::ostream &out) : stream_(&out) {}
+
+        /// Does not take ownership of `fd'.
+        explicit Writer(int fd) : fd_(fd) {}
+
+        Writer(const Writer &) = delete;
+        Writer &operator=(const Writer &) = delete;
+
+        /// Flushes what is left for streaming Writers.
+        ~Writer() { flush(); }
+
+        /// Appends `value' and everything below it.
+        void write(const JSON_Primitive &value);
+
+        /// Appends raw text, e.g. a newline between documents.
+        void write_raw(std::string_view text);
+
+        /// Hands buffered output to the sink, if any.  Returns false if
+        /// this or an earlier write to the sink failed.
+        bool flush();
+
+        /// False once writing to the sink has failed.
+        bool ok() const { return ok_; }
+
+        /// The unflushed output; everything for a Writer without a sink.
+        const std::string &str() const { return buffer_; }
+
+        /// Moves out the unflushed output and leaves the buffer empty.
+        std::string take() {
+            std::string result;
+            result.swap(buffer_);
+            return result;
+        }
+    };
+} // namespace json
+
+#endif